@@ -0,0 +1,188 @@
+//
+//  atlas.cpp
+//  Game
+//
+
+#include <stdexcept>
+#include <algorithm> // use of sort
+
+#include "atlas.hpp"
+#include "game.hpp"
+
+//Largest atlas width tried
+const int ATLAS_MAX_WIDTH = 4096;
+
+SpriteAtlas::SpriteAtlas(Game *mGamePtr_): mGamePtr(mGamePtr_), mTexture(NULL), mWidth(0), mHeight(0)
+{}
+
+SpriteAtlas::~SpriteAtlas()
+{
+    free();
+}
+
+void SpriteAtlas::free()
+{
+    for( size_t i = 0; i < mSprites.size(); ++i )
+    {
+        delete mSprites[i];
+    }
+    mSprites.clear();
+    mSources.clear();
+    mRects.clear();
+    
+    SDL_DestroyTexture( mTexture );
+    mTexture = NULL;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+//Sources sorted by decreasing height
+struct TallerSource
+{
+    const std::vector<LTexture*> *mSources;
+    bool operator()( int a, int b ) const
+    {
+        return (*mSources)[a]->getHeight() > (*mSources)[b]->getHeight();
+    }
+};
+
+void SpriteAtlas::pack()
+{
+    std::vector<int> order( mSources.size() );
+    int widest = 0;
+    for( size_t i = 0; i < mSources.size(); ++i )
+    {
+        order[i] = (int)i;
+        widest = std::max( widest, mSources[i]->getWidth() + 2 * ATLAS_PADDING );
+    }
+    TallerSource taller = { &mSources };
+    std::sort( order.begin(), order.end(), taller );
+    
+    //Try every power of two width and keep the smallest atlas
+    long bestArea = -1;
+    std::vector<SDL_Rect> rects( mSources.size() );
+    for( int width = 64; width <= ATLAS_MAX_WIDTH; width *= 2 )
+    {
+        if( width < widest )
+        {
+            continue;
+        }
+        
+        //Place the sources left to right on shelves as tall as their first (tallest) source
+        int x = 0, y = 0, shelfHeight = 0;
+        for( size_t i = 0; i < order.size(); ++i )
+        {
+            const LTexture &source = *mSources[order[i]];
+            int w = source.getWidth() + 2 * ATLAS_PADDING, h = source.getHeight() + 2 * ATLAS_PADDING;
+            if( x + w > width )
+            {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            SDL_Rect rect = { x + ATLAS_PADDING, y + ATLAS_PADDING, source.getWidth(), source.getHeight() };
+            rects[order[i]] = rect;
+            x += w;
+            shelfHeight = std::max( shelfHeight, h );
+        }
+        
+        long area = (long)width * ( y + shelfHeight );
+        if( bestArea < 0 || area < bestArea )
+        {
+            bestArea = area;
+            mWidth = width;
+            mHeight = y + shelfHeight;
+            mRects = rects;
+        }
+    }
+    
+    if( bestArea < 0 )
+    {
+        throw std::runtime_error("Sprites too large for the atlas!\n");
+    }
+}
+
+bool SpriteAtlas::build( LTexture *const sources_[], int count )
+{
+    std::string errormsg;
+    free();
+    
+    SDL_Renderer *renderer = mGamePtr->GetRenderer();
+    if( !SDL_RenderTargetSupported( renderer ) || count == 0 )
+    {
+        return false;
+    }
+    
+    mSources.assign( sources_, sources_ + count );
+    pack();
+    
+    mTexture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, mWidth, mHeight );
+    if( mTexture == NULL )
+    {
+        errormsg = "Unable to create the sprite atlas! SDL Error: %s\n";
+        errormsg.append(SDL_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+    rebuild();
+    
+    //A view of every region, drawn like the source texture
+    for( int i = 0; i < count; ++i )
+    {
+        LTexture *sprite = new LTexture(mGamePtr);
+        sprite->loadFromAtlas( *this, mRects[i] );
+        mSprites.push_back( sprite );
+    }
+    return true;
+}
+
+void SpriteAtlas::rebuild()
+{
+    if( mTexture == NULL )
+    {
+        return;
+    }
+    
+    SDL_Renderer *renderer = mGamePtr->GetRenderer();
+    SDL_Texture *target = SDL_GetRenderTarget( renderer );
+    SDL_SetRenderTarget( renderer, mTexture );
+    
+    //Transparent everywhere, then copy the sources pixel for pixel (alpha included - no blending)
+    SDL_SetRenderDrawColor( renderer, 0, 0, 0, 0 );
+    SDL_RenderClear( renderer );
+    for( size_t i = 0; i < mSources.size(); ++i )
+    {
+        SDL_BlendMode blendMode;
+        SDL_GetTextureBlendMode( mSources[i]->getTexture(), &blendMode );
+        SDL_SetTextureBlendMode( mSources[i]->getTexture(), SDL_BLENDMODE_NONE );
+        SDL_RenderCopy( renderer, mSources[i]->getTexture(), NULL, &mRects[i] );
+        SDL_SetTextureBlendMode( mSources[i]->getTexture(), blendMode );
+    }
+    
+    SDL_SetRenderTarget( renderer, target );
+}
+
+bool SpriteAtlas::isBuilt() const
+{
+    return mTexture != NULL;
+}
+
+const LTexture& SpriteAtlas::getSprite( int index ) const
+{
+    return(*mSprites[index]);
+}
+
+SDL_Texture* SpriteAtlas::getTexture() const
+{
+    return(mTexture);
+}
+
+int SpriteAtlas::getWidth() const
+{
+    return(mWidth);
+}
+
+int SpriteAtlas::getHeight() const
+{
+    return(mHeight);
+}
@@ -0,0 +1,66 @@
+//
+//  atlas.hpp
+//  Game
+//
+//  Sprite atlas: all sprite textures packed into one texture at load time, so the render
+//  queue draws every sprite from the same texture (see RenderQueue::Flush).
+//
+
+#ifndef atlas_h
+#define atlas_h
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+class Game;
+class LTexture;
+
+//Space left around every sprite so linear filtering never reads a neighbour
+const int ATLAS_PADDING = 1;
+
+class SpriteAtlas
+{
+public:
+    //Constructor: Initializes the variables
+    SpriteAtlas(Game *mGamePtr_);
+    //Destructor: releases the atlas texture
+    ~SpriteAtlas();
+    
+    //Packs the textures into one texture and makes a view of each one - returns false (and keeps
+    //nothing) when the renderer cannot render to textures, the sources must then be drawn directly.
+    //The sources must stay loaded, the atlas is copied from them again by rebuild().
+    bool build( LTexture *const sources_[], int count );
+    //Copies the sources into the atlas again (render target contents are lost on SDL_RENDER_TARGETS_RESET)
+    void rebuild();
+    //Releases the atlas texture and the views
+    void free();
+    
+    //True once build() succeeded
+    bool isBuilt() const;
+    //Region of the atlas that holds source index
+    const LTexture &getSprite( int index ) const;
+    
+    //Atlas texture and dimensions
+    SDL_Texture* getTexture() const;
+    int getWidth() const;
+    int getHeight() const;
+    
+private:
+    
+    SpriteAtlas( const SpriteAtlas &other_); //disable copy constructor
+    
+    //Chooses the atlas size and the place of every source (shelf packing by height)
+    void pack();
+    
+    // pointer to game
+    Game *mGamePtr;
+    //The atlas texture (a render target)
+    SDL_Texture* mTexture;
+    int mWidth, mHeight;
+    
+    std::vector<LTexture*> mSources; //textures packed into the atlas (not owned)
+    std::vector<SDL_Rect> mRects; //place of each source in the atlas
+    std::vector<LTexture*> mSprites; //view of each source region
+};
+
+#endif /* atlas_h */
@@ -0,0 +1,108 @@
+//
+//  batch.cpp
+//  Game
+//
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm> // use of sort
+
+#include "batch.hpp"
+#include "threadpool.hpp"
+#include "simulation.hpp"
+#include "controller.hpp"
+
+BatchRunner::BatchRunner( const GameConfig &config_ ): mConfig(config_)
+{}
+
+void BatchRunner::PlayGame( unsigned int index )
+{
+    GameConfig gameConfig = mConfig;
+    gameConfig.mSeed = mConfig.mSeed + index;
+    Simulation sim( gameConfig );
+    BoatController *controller = CreateHeadlessController( mConfig );
+    
+    while( !sim.IsGameOver() && sim.GetTickCount() < mConfig.mBatchMaxTicks )
+    {
+        sim.SetBoatCommand( controller->Update( sim.GetWorldView() ) );
+        sim.Tick();
+    }
+    delete controller;
+    
+    GameResult &result = mResults[index];
+    result.mSeed = gameConfig.mSeed;
+    result.mScore = sim.GetScore();
+    result.mLivesLost = INITIAL_LIFE - sim.GetLife() + ( sim.IsGameOver() ? 1 : 0 );
+    result.mTicks = sim.GetTickCount();
+    result.mGameOver = sim.IsGameOver();
+}
+
+void BatchRunner::Run()
+{
+    mResults.assign( mConfig.mBatchGames, GameResult() );
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    //One task per game - games differ in length, idle workers steal the games still queued elsewhere
+    ThreadPool pool( mConfig.mBatchThreads );
+    for( unsigned int i = 0; i < mConfig.mBatchGames; ++i )
+    {
+        pool.Submit( std::bind( &BatchRunner::PlayGame, this, i ) );
+    }
+    pool.Wait();
+    
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    PrintStatistics( seconds, pool.GetThreadCount(), pool.GetSteals() );
+}
+
+//Mean, standard deviation and percentiles of a sample
+static void PrintDistribution( const char *name, std::vector<double> values )
+{
+    if( values.empty() )
+    {
+        return;
+    }
+    
+    double sum = 0.0, squares = 0.0;
+    for( size_t i = 0; i < values.size(); ++i )
+    {
+        sum += values[i];
+        squares += values[i] * values[i];
+    }
+    double mean = sum / values.size();
+    double variance = squares / values.size() - mean * mean;
+    
+    std::sort( values.begin(), values.end() );
+    printf( "%-12s mean %10.1f  stddev %10.1f  min %8.0f  p10 %8.0f  p50 %8.0f  p90 %8.0f  max %8.0f\n", name, mean, sqrt( variance > 0.0 ? variance : 0.0 ),
+            values.front(), values[values.size() / 10], values[values.size() / 2], values[values.size() * 9 / 10], values.back() );
+}
+
+void BatchRunner::PrintStatistics( double seconds, unsigned int threads, unsigned long steals ) const
+{
+    std::vector<double> scores, livesLost, ticks;
+    unsigned long totalTicks = 0, unfinished = 0;
+    for( size_t i = 0; i < mResults.size(); ++i )
+    {
+        scores.push_back( mResults[i].mScore );
+        livesLost.push_back( mResults[i].mLivesLost );
+        ticks.push_back( mResults[i].mTicks );
+        totalTicks += mResults[i].mTicks;
+        unfinished += mResults[i].mGameOver ? 0 : 1;
+    }
+    
+    printf( "Played %lu games on %u threads in %.3f s (%.0f games/s, %.0f ticks/s, %lu games stolen)\n", (unsigned long)mResults.size(), threads, seconds,
+            seconds > 0 ? mResults.size() / seconds : 0.0, seconds > 0 ? totalTicks / seconds : 0.0, steals );
+    PrintDistribution( "Score", scores );
+    PrintDistribution( "Lives lost", livesLost );
+    PrintDistribution( "Ticks", ticks );
+    if( unfinished > 0 )
+    {
+        printf( "%lu games hit the limit of %lu ticks\n", unfinished, mConfig.mBatchMaxTicks );
+    }
+}
+
+const std::vector<GameResult>& BatchRunner::GetResults() const
+{
+    return(mResults);
+}
@@ -0,0 +1,51 @@
+//
+//  batch.hpp
+//  Game
+//
+//  Batch simulator: plays many independent games on a thread pool (one task per game,
+//  every game with its own seed and boat controller) and aggregates their outcomes.
+//
+
+#ifndef batch_h
+#define batch_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "config.hpp"
+
+//Outcome of one game
+struct GameResult
+{
+    uint64_t mSeed; //seed the game was played with
+    unsigned int mScore;
+    int mLivesLost; //lives lost (the game is over after losing all lives and one more)
+    unsigned long mTicks; //ticks survived
+    bool mGameOver; //false if the game hit the tick limit
+};
+
+class BatchRunner
+{
+public:
+    //Constructor: Initializes the variables
+    BatchRunner( const GameConfig &config_ = GameConfig() );
+    //Plays the games and prints the statistics
+    void Run();
+    
+    //Outcomes of the last Run, by game index
+    const std::vector<GameResult> &GetResults() const;
+    
+private:
+    
+    BatchRunner( const BatchRunner &other_); //disable copy constructor
+    
+    //Plays game index to the end (runs on a pool thread)
+    void PlayGame( unsigned int index );
+    //Prints the aggregated statistics
+    void PrintStatistics( double seconds, unsigned int threads, unsigned long steals ) const;
+    
+    GameConfig mConfig; //run options
+    std::vector<GameResult> mResults; //one per game, written only by the task of the game
+};
+
+#endif /* batch_h */
@@ -0,0 +1,594 @@
+//
+//  bench.cpp
+//  Game
+//
+//  Benchmarks of the simulation core (no SDL needed, asset loading is measured when built with BENCH_ASSETS).
+//  Every benchmark runs until it was timed for BENCH_MIN_SECONDS, results can be written as
+//  Google Benchmark style JSON (--json PATH) so runs can be compared.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread> // use of hardware_concurrency
+
+#ifdef BENCH_ASSETS
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#endif
+
+#include "config.hpp"
+#include "simulation.hpp"
+#include "kernel.hpp"
+#include "grid.hpp"
+#include "controller.hpp"
+
+//Ticks the kernels are compared over before they are timed
+const int KERNEL_CHECK_TICKS = 200;
+//Minimum time a benchmark is measured for
+const double BENCH_MIN_SECONDS = 0.1;
+//Simulation::Move ticks run between two top ups of the parachutists
+const unsigned long MOVE_BATCH_TICKS = 16;
+
+//Result of one benchmark
+struct BenchResult
+{
+    std::string mName; //benchmark name (BM_<what>/<parachutists>)
+    unsigned long mIterations; //iterations measured
+    double mRealTime; //nanoseconds per iteration
+    double mItemsPerSecond; //items (parachutists, ticks or assets) processed per second
+    double mBytesPerSecond; //bytes processed per second (0 when the benchmark does not count bytes)
+};
+
+//All results of the run, written as JSON at the end
+static std::vector<BenchResult> gResults;
+//Only benchmarks whose name contains the filter are run (NULL runs everything)
+static const char *gFilter = NULL;
+//Results written here so the compiler cannot drop a benchmarked loop
+static volatile int gSink;
+
+static bool IsSelected( const std::string &name )
+{
+    return gFilter == NULL || name.find( gFilter ) != std::string::npos;
+}
+
+static std::string BenchName( const char *what, unsigned int count )
+{
+    char name[64];
+    snprintf( name, sizeof(name), "BM_%s/%u", what, count );
+    return name;
+}
+
+static double ElapsedNanoseconds( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+}
+
+//Runs a benchmark with more and more iterations until it was timed for BENCH_MIN_SECONDS and records the result.
+//run( iterations ) runs the iterations and returns the nanoseconds it measured (setup between iterations can be left out).
+template<class Run>
+static void Measure( const std::string &name, double itemsPerIteration, Run run, double bytesPerIteration = 0.0 )
+{
+    unsigned long iterations = 1;
+    double nanoseconds = run( iterations );
+    while( nanoseconds < BENCH_MIN_SECONDS * 1e9 && iterations < ( 1ul << 30 ) )
+    {
+        //Aim a bit past the minimum time, but at most 10 times more iterations per round
+        double scale = nanoseconds > 0.0 ? BENCH_MIN_SECONDS * 1e9 * 1.4 / nanoseconds : 10.0;
+        iterations = (unsigned long)( iterations * ( scale < 10.0 ? scale : 10.0 ) ) + 1;
+        nanoseconds = run( iterations );
+    }
+
+    BenchResult result;
+    result.mName = name;
+    result.mIterations = iterations;
+    result.mRealTime = nanoseconds / iterations;
+    result.mItemsPerSecond = itemsPerIteration * iterations * 1e9 / nanoseconds;
+    result.mBytesPerSecond = bytesPerIteration * iterations * 1e9 / nanoseconds;
+    gResults.push_back( result );
+    printf( "%-28s %14.1f ns %12lu iterations %14.0f items/s", name.c_str(), result.mRealTime, iterations, result.mItemsPerSecond );
+    if( bytesPerIteration > 0.0 )
+    {
+        printf( " %10.0f bytes %8.2f GB/s", bytesPerIteration, result.mBytesPerSecond / 1e9 );
+    }
+    printf( "\n" );
+}
+
+//Fills a pool with parachutists spread over the screen height so every kernel branch is taken
+static void FillPool( ParachutistPool &pool, const Boat &boat, unsigned int count, Simulation *simulation = NULL )
+{
+    unsigned int perWave = count / 250 + 1;
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        pool.Add( Parachutist( simulation, ( i * 37 ) % SCREEN_WIDTH ) );
+        if( i % perWave == 0 )
+        {
+            pool.Step( boat, false );
+        }
+    }
+}
+
+//Runs both kernels on the same parachutists and checks they agree on every tick
+static bool CheckKernel( unsigned int count )
+{
+    Boat boat( NULL );
+    ParachutistPool scalarPool( NULL, count ), simdPool( NULL, count );
+    FillPool( scalarPool, boat, count );
+    FillPool( simdPool, boat, count );
+
+    boat.KeyDown( BOAT_KEY_RIGHT );
+    for( int tick = 0; tick < KERNEL_CHECK_TICKS; ++tick )
+    {
+        boat.move();
+        const int *scalarFlags = scalarPool.Step( boat, false );
+        const int *simdFlags = simdPool.Step( boat, true );
+        for( unsigned int i = 0; i < count; ++i )
+        {
+            if( scalarFlags[i] != simdFlags[i] || scalarPool.GetPosX( i ) != simdPool.GetPosX( i ) || scalarPool.GetPosY( i ) != simdPool.GetPosY( i ) )
+            {
+                printf( "kernel mismatch: %u parachutists, tick %d, index %u\n", count, tick, i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Runs the fused kernel and the broad phase path on the same parachutists and checks they agree on every tick
+static bool CheckBroadPhase( unsigned int count )
+{
+    Boat boat( NULL );
+    SpatialGrid grid( SCREEN_WIDTH, SCREEN_HEIGHT );
+    ParachutistPool fusedPool( NULL, count ), gridPool( NULL, count );
+    FillPool( fusedPool, boat, count );
+    FillPool( gridPool, boat, count );
+
+    boat.KeyDown( BOAT_KEY_RIGHT );
+    for( int tick = 0; tick < KERNEL_CHECK_TICKS; ++tick )
+    {
+        boat.move();
+        const int *fusedFlags = fusedPool.Step( boat, true );
+        const int *gridFlags = gridPool.Step( boat, true, &grid );
+        for( unsigned int i = 0; i < count; ++i )
+        {
+            if( fusedFlags[i] != gridFlags[i] || fusedPool.GetPosX( i ) != gridPool.GetPosX( i ) || fusedPool.GetPosY( i ) != gridPool.GetPosY( i ) )
+            {
+                printf( "broad phase mismatch: %u parachutists, tick %d, index %u\n", count, tick, i );
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Spawn throughput: parachutists created and added to an empty pool
+static void BenchSpawn( unsigned int count )
+{
+    std::string name = BenchName( "Spawn", count );
+    if( !IsSelected( name ) )
+    {
+        return;
+    }
+
+    ParachutistPool pool( NULL, count );
+    Measure( name, count, [&]( unsigned long iterations )
+    {
+        double nanoseconds = 0.0;
+        for( unsigned long iteration = 0; iteration < iterations; ++iteration )
+        {
+            pool.Clear();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for( unsigned int i = 0; i < count; ++i )
+            {
+                pool.Add( Parachutist( NULL, ( i * 37 ) % SCREEN_WIDTH ) );
+            }
+            nanoseconds += ElapsedNanoseconds( start );
+        }
+        gSink = pool.GetCount();
+        return nanoseconds;
+    } );
+}
+
+//Simulation::Move ticks per second with count parachutists alive (items = ticks)
+static void BenchMove( unsigned int count )
+{
+    std::string name = BenchName( "Move", count );
+    if( !IsSelected( name ) )
+    {
+        return;
+    }
+
+    GameConfig config;
+    config.mMaxParachutists = count * 2; // the airplane keeps dropping parachutists too
+    Simulation simulation( config );
+    FillPool( simulation.GetParachutists(), simulation.GetBoat(), count, &simulation );
+    
+    //Every batch starts from the same mid-game state
+    std::vector<unsigned char> snapshot( simulation.GetSnapshotCapacity() );
+    size_t snapshotSize = simulation.SaveSnapshot( snapshot.data(), snapshot.size() );
+
+    Measure( name, 1.0, [&]( unsigned long iterations )
+    {
+        double nanoseconds = 0.0;
+        for( unsigned long done = 0; done < iterations; done += MOVE_BATCH_TICKS )
+        {
+            //Bring back the parachutists that landed or left the screen (not timed)
+            simulation.LoadSnapshot( snapshot.data(), snapshotSize );
+
+            unsigned long batch = iterations - done < MOVE_BATCH_TICKS ? iterations - done : MOVE_BATCH_TICKS;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for( unsigned long tick = 0; tick < batch; ++tick )
+            {
+                simulation.Move();
+            }
+            nanoseconds += ElapsedNanoseconds( start );
+        }
+        return nanoseconds;
+    } );
+}
+
+//Plays a game from a snapshot, restores the snapshot into the game and into a new game, plays both again
+//and checks all three runs end in the same state
+static bool CheckSnapshot( unsigned int count )
+{
+    GameConfig config;
+    config.mMaxParachutists = count * 2;
+    Simulation simulation( config ), restored( config );
+    FillPool( simulation.GetParachutists(), simulation.GetBoat(), count, &simulation );
+    InterceptController controller;
+    
+    std::vector<unsigned char> snapshot( simulation.GetSnapshotCapacity() );
+    size_t snapshotSize = simulation.SaveSnapshot( snapshot.data(), snapshot.size() );
+    
+    uint64_t hashes[3];
+    Simulation *runs[3] = { &simulation, &simulation, &restored };
+    for( int run = 0; run < 3; ++run )
+    {
+        if( run > 0 && !runs[run]->LoadSnapshot( snapshot.data(), snapshotSize ) )
+        {
+            printf( "snapshot not restored: %u parachutists\n", count );
+            return false;
+        }
+        for( int tick = 0; tick < KERNEL_CHECK_TICKS; ++tick )
+        {
+            runs[run]->SetBoatCommand( controller.Update( runs[run]->GetWorldView() ) );
+            runs[run]->Tick();
+        }
+        hashes[run] = runs[run]->GetStateHash();
+    }
+    
+    if( hashes[0] != hashes[1] || hashes[0] != hashes[2] )
+    {
+        printf( "snapshot mismatch: %u parachutists\n", count );
+        return false;
+    }
+    return true;
+}
+
+//Snapshot save and restore of a game with count parachutists alive (items = parachutists, bytes = snapshot size)
+static void BenchSnapshot( unsigned int count )
+{
+    std::string saveName = BenchName( "SnapshotSave", count ), loadName = BenchName( "SnapshotLoad", count );
+    if( !IsSelected( saveName ) && !IsSelected( loadName ) )
+    {
+        return;
+    }
+    
+    GameConfig config;
+    config.mMaxParachutists = count;
+    Simulation simulation( config );
+    FillPool( simulation.GetParachutists(), simulation.GetBoat(), count, &simulation );
+    std::vector<unsigned char> snapshot( simulation.GetSnapshotCapacity() );
+    size_t snapshotSize = simulation.GetSnapshotSize();
+    
+    if( IsSelected( saveName ) )
+    {
+        Measure( saveName, count, [&]( unsigned long iterations )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t written = 0;
+            for( unsigned long i = 0; i < iterations; ++i )
+            {
+                written += simulation.SaveSnapshot( snapshot.data(), snapshot.size() );
+            }
+            gSink = (int)written;
+            return ElapsedNanoseconds( start );
+        }, (double)snapshotSize );
+    }
+    
+    if( IsSelected( loadName ) )
+    {
+        simulation.SaveSnapshot( snapshot.data(), snapshot.size() );
+        Measure( loadName, count, [&]( unsigned long iterations )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int loaded = 0;
+            for( unsigned long i = 0; i < iterations; ++i )
+            {
+                loaded += simulation.LoadSnapshot( snapshot.data(), snapshotSize ) ? 1 : 0;
+            }
+            gSink = loaded;
+            return ElapsedNanoseconds( start );
+        }, (double)snapshotSize );
+    }
+}
+
+//One intercept controller decision per iteration with count parachutists alive (items = parachutists looked at)
+static void BenchIntercept( unsigned int count )
+{
+    std::string name = BenchName( "Intercept", count );
+    if( !IsSelected( name ) )
+    {
+        return;
+    }
+
+    GameConfig config;
+    config.mMaxParachutists = count;
+    Simulation simulation( config );
+    FillPool( simulation.GetParachutists(), simulation.GetBoat(), count, &simulation );
+    WorldView view = simulation.GetWorldView();
+    InterceptController controller;
+
+    Measure( name, count, [&]( unsigned long iterations )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int sum = 0;
+        for( unsigned long i = 0; i < iterations; ++i )
+        {
+            //Move the boat so every decision differs
+            view.mBoatPosX = (int)( i % ( SCREEN_WIDTH - view.mBoatWidth ) );
+            sum += controller.Update( view );
+        }
+        gSink = sum;
+        return ElapsedNanoseconds( start );
+    } );
+}
+
+//One parachutist kernel step (move and boat floor test) per iteration: scalar, SIMD or through the broad phase grid
+static void BenchStep( unsigned int count )
+{
+    const char *names[3] = { "StepScalar", "StepSimd", "StepGrid" };
+    for( int variant = 0; variant < 3; ++variant )
+    {
+        std::string name = BenchName( names[variant], count );
+        if( !IsSelected( name ) )
+        {
+            continue;
+        }
+
+        Boat boat( NULL );
+        SpatialGrid grid( SCREEN_WIDTH, SCREEN_HEIGHT );
+        ParachutistPool pool( NULL, count );
+        FillPool( pool, boat, count );
+
+        Measure( name, count, [&]( unsigned long iterations )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for( unsigned long tick = 0; tick < iterations; ++tick )
+            {
+                pool.Step( boat, variant != 0, variant == 2 ? &grid : NULL );
+            }
+            return ElapsedNanoseconds( start );
+        } );
+    }
+}
+
+//Collision cost: boat floor tests of every parachutist without moving them
+static void BenchCollision( unsigned int count )
+{
+    std::string name = BenchName( "Collision", count );
+    if( !IsSelected( name ) )
+    {
+        return;
+    }
+
+    Boat boat( NULL );
+    ParachutistPool pool( NULL, count );
+    FillPool( pool, boat, count );
+
+    //Same arrays and boat floor as ParachutistPool::Step builds
+    std::vector<int> posX( count ), posY( count ), vel( count ), height( count ), legLeft( count ), legRight( count ), flags( count );
+    std::vector<unsigned int> indices( count );
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        posX[i] = pool.GetPosX( i );
+        posY[i] = pool.GetPosY( i );
+        vel[i] = pool.GetVel( i );
+        height[i] = pool.GetHeight( i );
+        legLeft[i] = (int)ceil( pool.GetWidth( i ) * 0.375 );
+        legRight[i] = (int)floor( pool.GetWidth( i ) * 0.625 );
+        indices[i] = i;
+    }
+    ParachutistArrays arrays;
+    arrays.mPosX = &posX[0];
+    arrays.mPosY = &posY[0];
+    arrays.mVel = &vel[0];
+    arrays.mHeight = &height[0];
+    arrays.mLegLeft = &legLeft[0];
+    arrays.mLegRight = &legRight[0];
+    arrays.mFlags = &flags[0];
+    arrays.mCount = count;
+
+    BoatFloor floor;
+    floor.mFloorY = (int)::floor( boat.GetPosY() + boat.GetHeight() * 0.9 );
+    floor.mLeft = boat.GetPosX();
+    floor.mRight = boat.GetPosX() + boat.GetWidth();
+
+    Measure( name, count, [&]( unsigned long iterations )
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for( unsigned long iteration = 0; iteration < iterations; ++iteration )
+        {
+            TestParachutists( arrays, floor, &indices[0], count );
+        }
+        double nanoseconds = ElapsedNanoseconds( start );
+        gSink = flags[count - 1];
+        return nanoseconds;
+    } );
+}
+
+#ifdef BENCH_ASSETS
+//Asset load time: decoding an image file and colour keying it the way the game does (the texture upload needs a window)
+static void BenchAssetLoad()
+{
+    if( !( IMG_Init( IMG_INIT_PNG ) & IMG_INIT_PNG ) )
+    {
+        printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+        return;
+    }
+
+    std::vector<std::string> paths;
+    for( int sprite = 0; sprite < SPRITE_COUNT; ++sprite )
+    {
+        paths.push_back( SPRITES[sprite].mPath );
+    }
+    paths.push_back( "background.bmp" );
+
+    for( size_t i = 0; i < paths.size(); ++i )
+    {
+        std::string name = "BM_AssetLoad/" + paths[i];
+        if( !IsSelected( name ) )
+        {
+            continue;
+        }
+
+        bool loaded = true;
+        Measure( name, 1.0, [&]( unsigned long iterations )
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for( unsigned long iteration = 0; iteration < iterations && loaded; ++iteration )
+            {
+                SDL_Surface *surface = IMG_Load( paths[i].c_str() );
+                if( surface == NULL )
+                {
+                    loaded = false;
+                    break;
+                }
+                SDL_SetColorKey( surface, SDL_TRUE, SDL_MapRGB( surface->format, 0, 0xFF, 0xFF ) );
+                SDL_FreeSurface( surface );
+            }
+            //A missing asset stops the measurement right away
+            return loaded ? ElapsedNanoseconds( start ) : BENCH_MIN_SECONDS * 1e9;
+        } );
+        if( !loaded )
+        {
+            printf( "Unable to load image %s! (run the benchmark from the asset directory)\n", paths[i].c_str() );
+            gResults.pop_back();
+        }
+    }
+
+    IMG_Quit();
+}
+#endif
+
+//Writes the results in the Google Benchmark JSON format, returns false if the file could not be written
+static bool WriteJson( const char *path )
+{
+    FILE *file = fopen( path, "w" );
+    if( file == NULL )
+    {
+        return false;
+    }
+
+    char date[64];
+    time_t now = time( NULL );
+    strftime( date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime( &now ) );
+
+    fprintf( file, "{\n  \"context\": {\n" );
+    fprintf( file, "    \"date\": \"%s\",\n", date );
+    fprintf( file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency() );
+    fprintf( file, "    \"simd_kernel\": \"%s\"\n", GetSimdKernelName() );
+    fprintf( file, "  },\n  \"benchmarks\": [\n" );
+    for( size_t i = 0; i < gResults.size(); ++i )
+    {
+        const BenchResult &result = gResults[i];
+        fprintf( file, "    {\n" );
+        fprintf( file, "      \"name\": \"%s\",\n", result.mName.c_str() );
+        fprintf( file, "      \"run_type\": \"iteration\",\n" );
+        fprintf( file, "      \"iterations\": %lu,\n", result.mIterations );
+        fprintf( file, "      \"real_time\": %.3f,\n", result.mRealTime );
+        fprintf( file, "      \"time_unit\": \"ns\",\n" );
+        if( result.mBytesPerSecond > 0.0 )
+        {
+            fprintf( file, "      \"bytes_per_second\": %.3f,\n", result.mBytesPerSecond );
+        }
+        fprintf( file, "      \"items_per_second\": %.3f\n", result.mItemsPerSecond );
+        fprintf( file, "    }%s\n", i + 1 < gResults.size() ? "," : "" );
+    }
+    fprintf( file, "  ]\n}\n" );
+
+    fclose( file );
+    return true;
+}
+
+int main( int argc, char* args[] )
+{
+    const char *jsonPath = NULL;
+
+    //Read the command line options
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( args[i], "--json" ) == 0 && i + 1 < argc )
+        {
+            jsonPath = args[++i]; // write the results as JSON
+        }
+        else if( strcmp( args[i], "--filter" ) == 0 && i + 1 < argc )
+        {
+            gFilter = args[++i]; // run only the benchmarks whose name contains the text
+        }
+    }
+
+    const unsigned int counts[] = { 10, 1000, 10000, 100000 };
+    const unsigned int countsSize = sizeof(counts) / sizeof(counts[0]);
+
+    //The optimized paths must give the same results as the plain ones before they are timed
+    bool identical = true;
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        identical = CheckKernel( counts[i] ) && identical;
+        identical = CheckBroadPhase( counts[i] ) && identical;
+        identical = CheckSnapshot( counts[i] ) && identical;
+    }
+
+    printf( "SIMD kernel: %s\n", GetSimdKernelName() );
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchSpawn( counts[i] );
+    }
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchMove( counts[i] );
+    }
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchStep( counts[i] );
+    }
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchCollision( counts[i] );
+    }
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchIntercept( counts[i] );
+    }
+    for( unsigned int i = 0; i < countsSize; ++i )
+    {
+        BenchSnapshot( counts[i] );
+    }
+#ifdef BENCH_ASSETS
+    BenchAssetLoad();
+#endif
+
+    if( jsonPath != NULL && !WriteJson( jsonPath ) )
+    {
+        printf( "Could not write the results to %s\n", jsonPath );
+        return 1;
+    }
+
+    return identical ? 0 : 1;
+}
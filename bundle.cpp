@@ -0,0 +1,229 @@
+//
+//  bundle.cpp
+//  Game
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "bundle.hpp"
+
+static const char BUNDLE_MAGIC[4] = { 'P', 'R', 'B', 'N' };
+
+static uint64_t AlignUp( uint64_t value )
+{
+    return ( value + BUNDLE_ALIGNMENT - 1 ) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+}
+
+AssetBundle::AssetBundle(): mData(NULL), mSize(0), mEntries(NULL), mEntryCount(0)
+{}
+
+AssetBundle::~AssetBundle()
+{
+    Close();
+}
+
+bool AssetBundle::Open( const std::string &path_ )
+{
+    std::string errormsg;
+    Close();
+    
+#ifdef _WIN32
+    //No mmap - read the whole file
+    FILE *file = fopen( path_.c_str(), "rb" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    fseek( file, 0, SEEK_END );
+    mSize = (size_t)ftell( file );
+    fseek( file, 0, SEEK_SET );
+    unsigned char *data = (unsigned char *)malloc( mSize );
+    if( data == NULL || fread( data, 1, mSize, file ) != mSize )
+    {
+        free( data );
+        fclose( file );
+        throw std::runtime_error("Unable to read the asset bundle!\n");
+    }
+    fclose( file );
+    mData = data;
+#else
+    int file = open( path_.c_str(), O_RDONLY );
+    if( file < 0 )
+    {
+        return false;
+    }
+    struct stat status;
+    if( fstat( file, &status ) != 0 || status.st_size == 0 )
+    {
+        close( file );
+        throw std::runtime_error("Unable to read the asset bundle!\n");
+    }
+    mSize = (size_t)status.st_size;
+    void *data = mmap( NULL, mSize, PROT_READ, MAP_PRIVATE, file, 0 );
+    close( file ); // the mapping keeps the file
+    if( data == MAP_FAILED )
+    {
+        mSize = 0;
+        throw std::runtime_error("Unable to map the asset bundle!\n");
+    }
+    mData = (const unsigned char *)data;
+#endif
+    
+    //Check the header and that every entry lies inside the file
+    const BundleHeader *header = (const BundleHeader *)mData;
+    if( mSize < sizeof(BundleHeader) || memcmp( header->mMagic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC) ) != 0 || header->mVersion != BUNDLE_VERSION ||
+        header->mEntryCount > ( mSize - sizeof(BundleHeader) ) / sizeof(BundleEntry) )
+    {
+        Close();
+        errormsg = "Not an asset bundle (or an older version): ";
+        errormsg.append(path_);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    mEntries = (const BundleEntry *)( mData + sizeof(BundleHeader) );
+    mEntryCount = header->mEntryCount;
+    for( unsigned int i = 0; i < mEntryCount; ++i )
+    {
+        if( mEntries[i].mOffset > mSize || mEntries[i].mSize > mSize - mEntries[i].mOffset || mEntries[i].mName[BUNDLE_NAME_SIZE - 1] != '\0' )
+        {
+            Close();
+            errormsg = "Asset bundle is damaged: ";
+            errormsg.append(path_);
+            throw std::runtime_error(errormsg.c_str());
+        }
+    }
+    
+    return true;
+}
+
+void AssetBundle::Close()
+{
+    if( mData != NULL )
+    {
+#ifdef _WIN32
+        free( (void *)mData );
+#else
+        munmap( (void *)mData, mSize );
+#endif
+    }
+    mData = NULL;
+    mSize = 0;
+    mEntries = NULL;
+    mEntryCount = 0;
+}
+
+bool AssetBundle::IsOpen() const
+{
+    return mData != NULL;
+}
+
+unsigned int AssetBundle::GetEntryCount() const
+{
+    return(mEntryCount);
+}
+
+const BundleEntry& AssetBundle::GetEntry( unsigned int index ) const
+{
+    return(mEntries[index]);
+}
+
+const BundleEntry* AssetBundle::Find( const std::string &name_ ) const
+{
+    for( unsigned int i = 0; i < mEntryCount; ++i )
+    {
+        if( name_ == mEntries[i].mName )
+        {
+            return &mEntries[i];
+        }
+    }
+    return(NULL);
+}
+
+const void* AssetBundle::GetData( const BundleEntry &entry_ ) const
+{
+    return mData + entry_.mOffset;
+}
+
+void BundleWriter::AddEntry( BundleEntry &entry_, const std::string &name_, const void *data_, size_t size_ )
+{
+    if( name_.size() >= (size_t)BUNDLE_NAME_SIZE )
+    {
+        throw std::runtime_error("Asset name too long for the bundle!\n");
+    }
+    strncpy( entry_.mName, name_.c_str(), BUNDLE_NAME_SIZE );
+    
+    //Data of every entry starts aligned
+    entry_.mOffset = AlignUp( mData.size() );
+    entry_.mSize = size_;
+    mData.resize( entry_.mOffset + size_ );
+    if( size_ > 0 )
+    {
+        memcpy( &mData[entry_.mOffset], data_, size_ );
+    }
+    mEntries.push_back( entry_ );
+}
+
+void BundleWriter::AddImage( const std::string &name_, uint32_t width_, uint32_t height_, uint32_t pitch_, uint32_t format_, bool opaque_, const void *pixels_ )
+{
+    BundleEntry entry;
+    memset( &entry, 0, sizeof(entry) );
+    entry.mType = BUNDLE_IMAGE;
+    entry.mFlags = opaque_ ? BUNDLE_OPAQUE : 0;
+    entry.mWidth = width_;
+    entry.mHeight = height_;
+    entry.mPitch = pitch_;
+    entry.mFormat = format_;
+    AddEntry( entry, name_, pixels_, (size_t)pitch_ * height_ );
+}
+
+void BundleWriter::AddFile( const std::string &name_, const void *data_, size_t size_ )
+{
+    BundleEntry entry;
+    memset( &entry, 0, sizeof(entry) );
+    entry.mType = BUNDLE_FILE;
+    AddEntry( entry, name_, data_, size_ );
+}
+
+bool BundleWriter::Write( const std::string &path_ ) const
+{
+    FILE *file = fopen( path_.c_str(), "wb" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    
+    BundleHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.mMagic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC) );
+    header.mVersion = BUNDLE_VERSION;
+    header.mEntryCount = (uint32_t)mEntries.size();
+    
+    //The data starts aligned after the entry table, the entry offsets become file offsets
+    uint64_t dataStart = AlignUp( sizeof(BundleHeader) + mEntries.size() * sizeof(BundleEntry) );
+    std::vector<BundleEntry> entries = mEntries;
+    for( size_t i = 0; i < entries.size(); ++i )
+    {
+        entries[i].mOffset += dataStart;
+    }
+    
+    bool written = fwrite( &header, sizeof(header), 1, file ) == 1;
+    written = written && ( entries.empty() || fwrite( &entries[0], sizeof(BundleEntry), entries.size(), file ) == entries.size() );
+    uint64_t position = sizeof(BundleHeader) + entries.size() * sizeof(BundleEntry);
+    for( ; written && position < dataStart; ++position )
+    {
+        written = fputc( 0, file ) != EOF;
+    }
+    written = written && ( mData.empty() || fwrite( &mData[0], 1, mData.size(), file ) == mData.size() );
+    
+    return fclose( file ) == 0 && written;
+}
@@ -0,0 +1,113 @@
+//
+//  bundle.hpp
+//  Game
+//
+//  Asset bundle: every asset of the game in one file, images already decoded to pixels.
+//  The game maps the file into memory and creates its textures straight from the mapped pixels,
+//  so starting the game decodes nothing. Bundles are made by the packer (pack.cpp).
+//
+//  File layout (native byte order - a bundle is built for the platform it runs on):
+//      BundleHeader, BundleEntry[mEntryCount], then the data of each entry at mOffset
+//      (aligned to BUNDLE_ALIGNMENT bytes)
+//
+
+#ifndef bundle_h
+#define bundle_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//Bundle format version (bumped on every layout change)
+const uint32_t BUNDLE_VERSION = 1;
+//Alignment of the entry data in the file
+const uint64_t BUNDLE_ALIGNMENT = 64;
+//Longest entry name (including the terminating zero)
+const int BUNDLE_NAME_SIZE = 64;
+
+//What an entry holds
+enum BundleEntryType
+{
+    BUNDLE_IMAGE = 1, //decoded pixels
+    BUNDLE_FILE = 2 //file copied as is (e.g. a font)
+};
+
+//Entry flags
+enum BundleEntryFlag
+{
+    BUNDLE_OPAQUE = 1 //image without transparent pixels (drawn without blending)
+};
+
+struct BundleHeader
+{
+    char mMagic[4]; //"PRBN"
+    uint32_t mVersion; //BUNDLE_VERSION
+    uint32_t mEntryCount; //number of entries after the header
+    uint32_t mReserved;
+};
+
+struct BundleEntry
+{
+    char mName[BUNDLE_NAME_SIZE]; //asset key (see GetAssetKey), zero terminated
+    uint32_t mType; //BundleEntryType
+    uint32_t mFlags; //BundleEntryFlag bits
+    uint32_t mWidth, mHeight; //image dimensions
+    uint32_t mPitch; //bytes per image row
+    uint32_t mFormat; //SDL pixel format of the image
+    uint64_t mOffset; //position of the data in the file
+    uint64_t mSize; //size of the data
+};
+
+//Read only view of a bundle file mapped into memory
+class AssetBundle
+{
+public:
+    //Constructor: Initializes the variables
+    AssetBundle();
+    //Destructor: unmaps the file
+    ~AssetBundle();
+    
+    //Maps the bundle - returns false if there is no such file, throws if the file is not a valid bundle
+    bool Open( const std::string &path_ );
+    //Unmaps the bundle (the data of the entries is gone)
+    void Close();
+    bool IsOpen() const;
+    
+    //Entries of the bundle
+    unsigned int GetEntryCount() const;
+    const BundleEntry &GetEntry( unsigned int index ) const;
+    //Returns the entry with the name, or NULL
+    const BundleEntry *Find( const std::string &name_ ) const;
+    //Returns the mapped data of an entry
+    const void *GetData( const BundleEntry &entry_ ) const;
+    
+private:
+    
+    AssetBundle( const AssetBundle &other_); //disable copy constructor
+    
+    const unsigned char *mData; //the mapped file
+    size_t mSize; //file size
+    const BundleEntry *mEntries; //entry table in the mapped file
+    unsigned int mEntryCount;
+};
+
+//Builds a bundle file (used by the packer)
+class BundleWriter
+{
+public:
+    //Adds decoded pixels, rows of pitch_ bytes
+    void AddImage( const std::string &name_, uint32_t width_, uint32_t height_, uint32_t pitch_, uint32_t format_, bool opaque_, const void *pixels_ );
+    //Adds a file copied as is
+    void AddFile( const std::string &name_, const void *data_, size_t size_ );
+    //Writes the bundle - returns false if the file cannot be written
+    bool Write( const std::string &path_ ) const;
+    
+private:
+    std::vector<BundleEntry> mEntries; //entries (offsets relative to the start of the data)
+    std::vector<unsigned char> mData; //data of all entries, aligned
+    
+    void AddEntry( BundleEntry &entry_, const std::string &name_, const void *data_, size_t size_ );
+};
+
+#endif /* bundle_h */
@@ -0,0 +1,327 @@
+//
+//  capture.cpp
+//  Game
+//
+
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+
+#include "capture.hpp"
+
+//Splits a frame file pattern around its frame number: one %d, %Nd or %0Nd, and %% for a literal % -
+//returns false for any other conversion (the path is never used as a printf format)
+static bool SplitNamePattern( const char *path, std::string &prefix, std::string &suffix, int &digits, bool &zeroPad )
+{
+    bool found = false;
+    std::string *part = &prefix;
+    for( const char *c = path; *c != '\0'; ++c )
+    {
+        if( *c != '%' )
+        {
+            part->push_back( *c );
+            continue;
+        }
+        if( c[1] == '%' )
+        {
+            part->push_back( '%' );
+            ++c;
+            continue;
+        }
+        
+        //The frame number
+        if( found )
+        {
+            return false;
+        }
+        ++c;
+        zeroPad = *c == '0';
+        digits = 0;
+        while( *c >= '0' && *c <= '9' )
+        {
+            digits = digits * 10 + ( *c - '0' );
+            if( digits > 20 )
+            {
+                return false;
+            }
+            ++c;
+        }
+        if( *c != 'd' )
+        {
+            return false;
+        }
+        found = true;
+        part = &suffix;
+    }
+    return found;
+}
+
+FrameCapture::FrameCapture( const char *path_, CaptureFormat format_, int width_, int height_, int fps_ ):
+                    mFormat(format_),
+                    mPerFrameFiles(format_ == CAPTURE_PPM && strchr( path_, '%' ) != NULL),
+                    mNameDigits(0),
+                    mNameZeroPad(false),
+                    mWidth(width_),
+                    mHeight(height_),
+                    mFile(NULL),
+                    mBuffers(CAPTURE_BUFFERS, std::vector<unsigned char>( (size_t)width_ * height_ * 4 )),
+                    mQueue(CAPTURE_BUFFERS),
+                    mQueueHead(0),
+                    mQueueCount(0),
+                    mAcquired(-1),
+                    mStop(false),
+                    mFailed(false),
+                    mWritten(0),
+                    mDropped(0)
+{
+    if( mPerFrameFiles && !SplitNamePattern( path_, mNamePrefix, mNameSuffix, mNameDigits, mNameZeroPad ) )
+    {
+        std::string errormsg = "The capture path ";
+        errormsg.append( path_ );
+        errormsg.append( " must have one frame number (%d, %5d or %05d) and %% for a literal %" );
+        throw std::runtime_error(errormsg.c_str());
+    }
+    if( !mPerFrameFiles )
+    {
+        mFile = fopen( path_, "wb" );
+        if( mFile == NULL )
+        {
+            std::string errormsg = "Unable to open the capture file ";
+            errormsg.append( path_ );
+            throw std::runtime_error(errormsg.c_str());
+        }
+        if( mFormat == CAPTURE_Y4M )
+        {
+            //Full range BT.601 samples, chroma centred between the luma samples (as JPEG)
+            fprintf( mFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", mWidth, mHeight, fps_ );
+        }
+    }
+    
+    for( unsigned int i = 0; i < CAPTURE_BUFFERS; ++i )
+    {
+        mFree.push_back( i );
+    }
+    mThread = std::thread( &FrameCapture::Write, this );
+}
+
+FrameCapture::~FrameCapture()
+{
+    Close();
+}
+
+void FrameCapture::Close()
+{
+    if( !mThread.joinable() )
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mStop = true;
+    }
+    mQueued.notify_one();
+    mThread.join();
+    
+    if( mFile != NULL )
+    {
+        fclose( mFile );
+        mFile = NULL;
+    }
+}
+
+void *FrameCapture::Acquire()
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mStop || mFree.empty() )
+    {
+        ++mDropped;
+        return NULL;
+    }
+    mAcquired = (int)mFree.back();
+    mFree.pop_back();
+    return &mBuffers[(size_t)mAcquired][0];
+}
+
+void FrameCapture::Submit()
+{
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        if( mAcquired < 0 )
+        {
+            return;
+        }
+        mQueue[( mQueueHead + mQueueCount ) % CAPTURE_BUFFERS] = (unsigned int)mAcquired;
+        ++mQueueCount;
+        mAcquired = -1;
+    }
+    mQueued.notify_one();
+}
+
+void FrameCapture::Cancel()
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    if( mAcquired < 0 )
+    {
+        return;
+    }
+    mFree.push_back( (unsigned int)mAcquired );
+    mAcquired = -1;
+    ++mDropped;
+}
+
+int FrameCapture::GetPitch() const
+{
+    return mWidth * 4;
+}
+
+unsigned long FrameCapture::GetWritten() const
+{
+    return mWritten.load();
+}
+
+unsigned long FrameCapture::GetDropped() const
+{
+    return mDropped.load();
+}
+
+void FrameCapture::Write()
+{
+    std::unique_lock<std::mutex> lock( mMutex );
+    for( ;; )
+    {
+        //Sleep until a frame is queued - the queued frames are still written once the capture closes
+        while( mQueueCount == 0 && !mStop )
+        {
+            mQueued.wait( lock );
+        }
+        if( mQueueCount == 0 )
+        {
+            break;
+        }
+        unsigned int buffer = mQueue[mQueueHead];
+        mQueueHead = ( mQueueHead + 1 ) % CAPTURE_BUFFERS;
+        --mQueueCount;
+        
+        //Convert and write without the lock, the game loop keeps taking the free buffers meanwhile
+        lock.unlock();
+        if( !mFailed && WriteFrame( &mBuffers[buffer][0], mWritten.load() ) )
+        {
+            ++mWritten;
+        }
+        else
+        {
+            mFailed = true; // a full disk does not get better - drop the rest
+            ++mDropped;
+        }
+        lock.lock();
+        mFree.push_back( buffer );
+    }
+}
+
+bool FrameCapture::WriteFrame( const unsigned char *pixels_, unsigned long frame )
+{
+    if( mFormat == CAPTURE_Y4M )
+    {
+        return WriteY4m( pixels_ );
+    }
+    if( !mPerFrameFiles )
+    {
+        return WritePpm( mFile, pixels_ );
+    }
+    
+    char number[32];
+    snprintf( number, sizeof(number), mNameZeroPad ? "%0*lu" : "%*lu", mNameDigits, frame );
+    std::string name = mNamePrefix + number + mNameSuffix;
+    FILE *file = fopen( name.c_str(), "wb" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    bool written = WritePpm( file, pixels_ );
+    return fclose( file ) == 0 && written;
+}
+
+//Channels of a 32 bit ARGB pixel
+static inline int Red( uint32_t pixel ) { return ( pixel >> 16 ) & 0xFF; }
+static inline int Green( uint32_t pixel ) { return ( pixel >> 8 ) & 0xFF; }
+static inline int Blue( uint32_t pixel ) { return pixel & 0xFF; }
+
+bool FrameCapture::WriteY4m( const unsigned char *pixels_ )
+{
+    static const char FRAME_HEADER[] = "FRAME\n";
+    const size_t headerSize = sizeof(FRAME_HEADER) - 1;
+    int chromaWidth = ( mWidth + 1 ) / 2, chromaHeight = ( mHeight + 1 ) / 2;
+    size_t lumaSize = (size_t)mWidth * mHeight, chromaSize = (size_t)chromaWidth * chromaHeight;
+    mConverted.resize( headerSize + lumaSize + 2 * chromaSize );
+    
+    memcpy( &mConverted[0], FRAME_HEADER, headerSize );
+    unsigned char *luma = &mConverted[headerSize];
+    unsigned char *cb = luma + lumaSize;
+    unsigned char *cr = cb + chromaSize;
+    const uint32_t *pixels = (const uint32_t *)pixels_;
+    
+    //Full range BT.601 in 8 bit fixed point
+    for( size_t i = 0; i < lumaSize; ++i )
+    {
+        uint32_t pixel = pixels[i];
+        luma[i] = (unsigned char)( ( 77 * Red( pixel ) + 150 * Green( pixel ) + 29 * Blue( pixel ) + 128 ) >> 8 );
+    }
+    
+    //Chroma of the average of each 2x2 block
+    for( int y = 0; y < chromaHeight; ++y )
+    {
+        const uint32_t *row0 = pixels + (size_t)( 2 * y ) * mWidth;
+        const uint32_t *row1 = 2 * y + 1 < mHeight ? row0 + mWidth : row0;
+        for( int x = 0; x < chromaWidth; ++x )
+        {
+            int x0 = 2 * x, x1 = 2 * x + 1 < mWidth ? 2 * x + 1 : 2 * x;
+            int r = ( Red( row0[x0] ) + Red( row0[x1] ) + Red( row1[x0] ) + Red( row1[x1] ) + 2 ) >> 2;
+            int g = ( Green( row0[x0] ) + Green( row0[x1] ) + Green( row1[x0] ) + Green( row1[x1] ) + 2 ) >> 2;
+            int b = ( Blue( row0[x0] ) + Blue( row0[x1] ) + Blue( row1[x0] ) + Blue( row1[x1] ) + 2 ) >> 2;
+            int u = ( -43 * r - 85 * g + 128 * b + 32768 + 128 ) >> 8;
+            int v = ( 128 * r - 107 * g - 21 * b + 32768 + 128 ) >> 8;
+            cb[(size_t)y * chromaWidth + x] = (unsigned char)( u > 255 ? 255 : u );
+            cr[(size_t)y * chromaWidth + x] = (unsigned char)( v > 255 ? 255 : v );
+        }
+    }
+    
+    return fwrite( &mConverted[0], 1, mConverted.size(), mFile ) == mConverted.size();
+}
+
+bool FrameCapture::WritePpm( FILE *file, const unsigned char *pixels_ )
+{
+    char header[64];
+    int headerSize = snprintf( header, sizeof(header), "P6\n%d %d\n255\n", mWidth, mHeight );
+    size_t pixelCount = (size_t)mWidth * mHeight;
+    mConverted.resize( headerSize + 3 * pixelCount );
+    
+    memcpy( &mConverted[0], header, headerSize );
+    unsigned char *rgb = &mConverted[headerSize];
+    const uint32_t *pixels = (const uint32_t *)pixels_;
+    for( size_t i = 0; i < pixelCount; ++i )
+    {
+        uint32_t pixel = pixels[i];
+        rgb[3 * i] = (unsigned char)Red( pixel );
+        rgb[3 * i + 1] = (unsigned char)Green( pixel );
+        rgb[3 * i + 2] = (unsigned char)Blue( pixel );
+    }
+    
+    return fwrite( &mConverted[0], 1, mConverted.size(), file ) == mConverted.size();
+}
+
+bool ParseCaptureFormat( const char *name, CaptureFormat *format )
+{
+    if( strcmp( name, "y4m" ) == 0 )
+    {
+        *format = CAPTURE_Y4M;
+    }
+    else if( strcmp( name, "ppm" ) == 0 )
+    {
+        *format = CAPTURE_PPM;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+//
+//  capture.hpp
+//  Game
+//
+//  Gameplay capture: the game loop reads each frame back into a buffer of a fixed pool and queues it,
+//  a writer thread converts the queued frames and streams them to disk. When every buffer waits for
+//  the disk the frame is dropped and counted - the game loop never waits for the writer.
+//
+
+#ifndef capture_h
+#define capture_h
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+
+//Frame buffers of a capture (frames read back but not written yet)
+const unsigned int CAPTURE_BUFFERS = 8;
+
+//Writes the rendered frames to disk on a thread of its own
+class FrameCapture
+{
+public:
+    //Constructor: opens the target and starts the writer thread. A PPM path with a frame number pattern
+    //(one %d, %5d or %05d, %% for a literal %, e.g. "frame%05d.ppm") writes one file per frame.
+    //Throws when the pattern is not one of those or the target can not be opened.
+    FrameCapture( const char *path_, CaptureFormat format_, int width_, int height_, int fps_ );
+    //Destructor: closes the capture
+    ~FrameCapture();
+    
+    //Producer: a free buffer for the next frame (32 bit ARGB pixels, GetPitch bytes per row) -
+    //NULL when every buffer waits for the disk (the frame is counted as dropped)
+    void *Acquire();
+    //Producer: queues the buffer taken by Acquire for writing
+    void Submit();
+    //Producer: gives back the buffer taken by Acquire without writing it (the frame is counted as dropped)
+    void Cancel();
+    
+    //Bytes per row of a buffer
+    int GetPitch() const;
+    
+    //Writes the queued frames, stops the writer thread and closes the target (later frames are dropped)
+    void Close();
+    
+    //Statistics
+    unsigned long GetWritten() const; //frames written
+    unsigned long GetDropped() const; //frames dropped because no buffer was free or the disk failed
+    
+private:
+    
+    FrameCapture( const FrameCapture &other_); //disable copy constructor
+    
+    //Writer thread: writes the queued frames until the capture is closed
+    void Write();
+    //Converts and writes one frame - returns false when the disk failed
+    bool WriteFrame( const unsigned char *pixels_, unsigned long frame );
+    bool WriteY4m( const unsigned char *pixels_ );
+    bool WritePpm( FILE *file, const unsigned char *pixels_ );
+    
+    CaptureFormat mFormat;
+    bool mPerFrameFiles; //one PPM file per frame (the path is a frame number pattern)
+    std::string mNamePrefix, mNameSuffix; //file name of a frame around its number
+    int mNameDigits; //least digits of the frame number
+    bool mNameZeroPad; //pad the frame number with zeros instead of spaces
+    int mWidth, mHeight;
+    FILE *mFile; //stream target (NULL for one file per frame)
+    
+    //Buffer pool: a buffer is free, held by the producer or queued - the queue can not outgrow the pool
+    std::vector< std::vector<unsigned char> > mBuffers;
+    std::vector<unsigned int> mFree; //free buffers
+    std::vector<unsigned int> mQueue; //ring of the queued buffers (oldest at mQueueHead)
+    unsigned int mQueueHead, mQueueCount;
+    int mAcquired; //buffer held by the producer (-1 = none)
+    std::mutex mMutex; //guards the free list and the queue
+    std::condition_variable mQueued; //signalled when a frame is queued or the capture closes
+    bool mStop; //set to end the writer thread
+    
+    //Writer thread only
+    std::vector<unsigned char> mConverted; //a frame converted to the file format
+    bool mFailed; //the disk failed, the frames are thrown away
+    
+    std::atomic<unsigned long> mWritten;
+    std::atomic<unsigned long> mDropped;
+    std::thread mThread;
+};
+
+//Parses a capture format name ("y4m" or "ppm") - returns false for an unknown name
+bool ParseCaptureFormat( const char *name, CaptureFormat *format );
+
+#endif /* capture_h */
@@ -0,0 +1,155 @@
+//
+//  config.hpp
+//  Game
+//
+//  Run options shared by the windowed game and the headless simulation.
+//
+
+#ifndef config_h
+#define config_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Default simulation rate - the game was tuned for one move per 60Hz frame
+const int DEFAULT_TICK_RATE = 60;
+//Maximum number of simulation ticks run to catch up before a frame is rendered
+const int DEFAULT_MAX_CATCH_UP_TICKS = 5;
+//Default number of parachutists that can be alive at the same time
+const unsigned int DEFAULT_MAX_PARACHUTISTS = 4096;
+//Default number of ticks simulated by a headless run
+const unsigned long DEFAULT_HEADLESS_TICKS = 1000000;
+//Default seed of the random jump points (every run plays the same game unless --seed is given)
+const uint64_t DEFAULT_SEED = 1;
+//Default longest game of a batch run (in ticks)
+const unsigned long DEFAULT_BATCH_MAX_TICKS = 1000000;
+//Default number of frames drawn by a render benchmark
+const unsigned long DEFAULT_RENDER_BENCH_FRAMES = 600;
+
+//Default asset bundle (made by the packer), the separate asset files are loaded when it does not exist
+const char *const DEFAULT_BUNDLE_PATH = "assets.bundle";
+//Default golden frame hashes of the render benchmark (the default session: seed, scenario, controller and frame count)
+const char *const DEFAULT_GOLDEN_PATH = "render_golden.txt";
+//Default file the frame profiler writes at exit
+const char *const DEFAULT_PROFILE_CSV = "profile.csv";
+
+//Controllers that can drive the boat (see controller.hpp)
+enum BoatControllerType
+{
+    CONTROLLER_KEYBOARD, //the player (arrow keys)
+    CONTROLLER_CHASE, //moves under the parachutist that is lowest on the screen
+    CONTROLLER_INTERCEPT //moves to where the next catchable parachutist lands
+};
+
+//Output formats of the telemetry (see telemetry.hpp)
+enum TelemetryFormat
+{
+    TELEMETRY_BINARY, //a TelemetryHeader then the records as they are in memory
+    TELEMETRY_JSON //one JSON object per line
+};
+
+//What the game spawns: the airplanes, their jumps and the parachutist waves (see scenario.hpp).
+//The defaults are the original game.
+struct Scenario
+{
+    //Initializes the original game
+    Scenario(): mAirplanes(1),
+                mJumpsPerPass(1),
+                mAirplaneVel(10),
+                mMinFallVel(4),
+                mMaxFallVel(4),
+                mWaveInterval(0),
+                mWaveSize(0),
+                mEndless(false),
+                mMaxParachutists(0)
+    {}
+    
+    unsigned int mAirplanes; //airplanes crossing the screen, spread evenly over their way
+    unsigned int mJumpsPerPass; //parachutists each airplane drops per pass over the screen
+    int mAirplaneVel; //airplane speed
+    int mMinFallVel, mMaxFallVel; //range of the parachutist fall speeds
+    unsigned int mWaveInterval; //ticks between two waves of parachutists (0 = no waves)
+    unsigned int mWaveSize; //parachutists a wave drops at random positions along the top of the screen
+    bool mEndless; //missed parachutists cost no life, the game never ends (stress runs)
+    unsigned int mMaxParachutists; //parachutist pool capacity the scenario needs (0 = the configured one)
+};
+
+//File format of a gameplay capture
+enum CaptureFormat
+{
+    CAPTURE_Y4M, //one YUV4MPEG2 stream (4:2:0)
+    CAPTURE_PPM //binary PPM images, one stream or one file per frame
+};
+
+//Game run options (set from the command line)
+struct GameConfig
+{
+    //Initializes the default options
+    GameConfig(): mTickRate(DEFAULT_TICK_RATE),
+                  mMaxCatchUpTicks(DEFAULT_MAX_CATCH_UP_TICKS),
+                  mVsync(true),
+                  mLowLatency(false),
+                  mSimulationThread(false),
+                  mHeadless(false),
+                  mHeadlessTicks(DEFAULT_HEADLESS_TICKS),
+                  mMaxParachutists(DEFAULT_MAX_PARACHUTISTS),
+                  mBroadPhase(false),
+                  mClearFrame(true),
+                  mDirtyRects(false),
+                  mProfile(false),
+                  mProfileOverlay(false),
+                  mProfileCsv(DEFAULT_PROFILE_CSV),
+                  mSeed(DEFAULT_SEED),
+                  mRecordPath(NULL),
+                  mReplayPath(NULL),
+                  mBundlePath(DEFAULT_BUNDLE_PATH),
+                  mBatchGames(0),
+                  mBatchThreads(0),
+                  mBatchMaxTicks(DEFAULT_BATCH_MAX_TICKS),
+                  mController(CONTROLLER_KEYBOARD),
+                  mTelemetryTarget(NULL),
+                  mTelemetryFormat(TELEMETRY_JSON),
+                  mScenarioName("classic"),
+                  mRenderBench(false),
+                  mRenderBenchFrames(DEFAULT_RENDER_BENCH_FRAMES),
+                  mGoldenPath(DEFAULT_GOLDEN_PATH),
+                  mUpdateGolden(false),
+                  mCapturePath(NULL),
+                  mCaptureFormat(CAPTURE_Y4M)
+    {}
+    
+    int mTickRate; //simulation ticks per second
+    int mMaxCatchUpTicks; //maximum ticks run before rendering a frame, excess time is dropped
+    bool mVsync; //pace rendering with the display refresh rate (false = uncapped rendering)
+    bool mLowLatency; //start frames as late as possible, sample the keyboard just before the ticks and keep no frame queued
+    bool mSimulationThread; //run the ticks on a thread of their own, the frames draw the states it publishes
+    bool mHeadless; //run the simulation only - no window, renderer or assets
+    unsigned long mHeadlessTicks; //number of ticks a headless run simulates
+    unsigned int mMaxParachutists; //capacity of the parachutist pool (allocated once)
+    bool mBroadPhase; //use the spatial grid so only parachutists near the boat floor are tested - slower than the fused kernel (see README)
+    bool mClearFrame; //clear the frame before drawing (not needed while the background covers the whole frame)
+    bool mDirtyRects; //redraw only the parts of the frame that changed, into a render target kept between frames
+    bool mProfile; //time the phases of every frame and write them to mProfileCsv at exit
+    bool mProfileOverlay; //draw the frame times on screen (implies mProfile)
+    const char *mProfileCsv; //file the frame profile is written to
+    uint64_t mSeed; //seed of the game random numbers (headless games n uses mSeed + n)
+    const char *mRecordPath; //input log the key transitions are recorded to (NULL = no recording)
+    const char *mReplayPath; //input log replayed instead of the keyboard (NULL = live input)
+    const char *mBundlePath; //asset bundle loaded instead of the separate asset files when it exists
+    unsigned int mBatchGames; //games played by a batch run (0 = no batch run)
+    unsigned int mBatchThreads; //threads of a batch run (0 = one per core)
+    unsigned long mBatchMaxTicks; //a batch game that lasts longer is stopped
+    BoatControllerType mController; //drives the boat (runs without a window use the intercept controller instead of the keyboard)
+    const char *mTelemetryTarget; //file or "unix:" socket the live telemetry is exported to (NULL = no telemetry)
+    TelemetryFormat mTelemetryFormat; //format of the exported telemetry
+    Scenario mScenario; //airplanes and waves of the game
+    const char *mScenarioName; //preset or file the scenario came from
+    bool mRenderBench; //draw frames with the software renderer offscreen (dummy video driver), one tick per frame
+    unsigned long mRenderBenchFrames; //frames drawn by the render benchmark
+    const char *mGoldenPath; //frame hashes the render benchmark compares against (NULL = no comparison, --no-golden)
+    bool mUpdateGolden; //write the frame hashes of the render benchmark to mGoldenPath instead of comparing
+    const char *mCapturePath; //file the rendered frames are captured to (NULL = no capture)
+    CaptureFormat mCaptureFormat; //format of the captured frames
+};
+
+#endif /* config_h */
@@ -0,0 +1,188 @@
+//
+//  controller.cpp
+//  Game
+//
+
+#include <string.h>
+
+#include "controller.hpp"
+
+//Distance from the target at which the chasing boat stops moving
+const int CHASE_DEAD_ZONE = 10;
+
+BoatController::~BoatController()
+{}
+
+KeyboardController::KeyboardController(): mLeft(false), mRight(false)
+{}
+
+void KeyboardController::KeyDown( BoatKey key )
+{
+    switch( key )
+    {
+        case BOAT_KEY_LEFT: mLeft = true; break;
+        case BOAT_KEY_RIGHT: mRight = true; break;
+    }
+}
+
+void KeyboardController::KeyUp( BoatKey key )
+{
+    switch( key )
+    {
+        case BOAT_KEY_LEFT: mLeft = false; break;
+        case BOAT_KEY_RIGHT: mRight = false; break;
+    }
+}
+
+void KeyboardController::SetKeys( bool left, bool right )
+{
+    mLeft = left;
+    mRight = right;
+}
+
+int KeyboardController::Update( const WorldView &/*view*/ )
+{
+    return( ( mRight ? 1 : 0 ) - ( mLeft ? 1 : 0 ) );
+}
+
+int ChaseController::Update( const WorldView &view )
+{
+    //Find the parachutist that is closest to landing
+    int target = -1;
+    for( unsigned int i = 0; i < view.mParachutistCount; ++i )
+    {
+        if( target < 0 || view.mParachutistPosY[i] > view.mParachutistPosY[target] )
+        {
+            target = (int)i;
+        }
+    }
+    if( target < 0 )
+    {
+        return 0;
+    }
+    
+    //Move the boat center under the parachutist center
+    int offset = ( view.mParachutistPosX[target] + view.mParachutistWidth[target] / 2 ) - ( view.mBoatPosX + view.mBoatWidth / 2 );
+    if( offset > CHASE_DEAD_ZONE )
+    {
+        return 1;
+    }
+    if( offset < -CHASE_DEAD_ZONE )
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int InterceptController::Update( const WorldView &view )
+{
+    int maxBoatX = SCREEN_WIDTH - view.mBoatWidth; // the boat can not leave the screen
+    
+    //The two catchable parachutists that land first, as the range of boat X offsets that catches each
+    unsigned int firstTicks = 0, secondTicks = 0;
+    int firstLeft = 0, firstRight = -1, secondLeft = 0, secondRight = -1;
+    
+    for( unsigned int i = 0; i < view.mParachutistCount; ++i )
+    {
+        //The feet are tested against the boat floor on the tick they are less than a move above it
+        int vel = view.mParachutistVel[i];
+        int above = view.mBoatFloorY - ( view.mParachutistPosY[i] + view.mParachutistHeight[i] );
+        if( vel <= 0 || above < vel )
+        {
+            continue; // landing now or already passed the boat
+        }
+        unsigned int ticks = (unsigned int)( above / vel );
+        
+        //Boat X offsets whose floor overlaps the legs at the landing
+        int posX = view.mParachutistPosX[i] - (int)ticks * ( vel / 4 );
+        int left = posX + view.mParachutistLegLeft[i] - view.mBoatWidth;
+        int right = posX + view.mParachutistLegRight[i];
+        left = left < 0 ? 0 : left;
+        right = right > maxBoatX ? maxBoatX : right;
+        if( left > right )
+        {
+            continue; // lands out of the boat's reach
+        }
+        
+        //Skip the parachutists the boat can not reach in time
+        int distance = view.mBoatPosX < left ? left - view.mBoatPosX : ( view.mBoatPosX > right ? view.mBoatPosX - right : 0 );
+        if( distance > (int)ticks * view.mBoatVel )
+        {
+            continue;
+        }
+        
+        if( firstRight < firstLeft || ticks < firstTicks )
+        {
+            secondTicks = firstTicks; secondLeft = firstLeft; secondRight = firstRight;
+            firstTicks = ticks; firstLeft = left; firstRight = right;
+        }
+        else if( secondRight < secondLeft || ticks < secondTicks )
+        {
+            secondTicks = ticks; secondLeft = left; secondRight = right;
+        }
+    }
+    
+    //Nothing to catch - wait in the middle, where the next parachutist is closest on average
+    int target = maxBoatX / 2;
+    if( firstLeft <= firstRight )
+    {
+        //Aim at the middle of the catching range, or as close to the next parachutist as the range allows
+        //(a move away from the range edges, so a move past the target never leaves the range)
+        target = ( firstLeft + firstRight ) / 2;
+        if( secondLeft <= secondRight && firstRight - firstLeft > 2 * view.mBoatVel )
+        {
+            int next = ( secondLeft + secondRight ) / 2;
+            int low = firstLeft + view.mBoatVel, high = firstRight - view.mBoatVel;
+            target = next < low ? low : ( next > high ? high : next );
+        }
+    }
+    
+    //Moves are mBoatVel long - stop within half a move of the target
+    int offset = target - view.mBoatPosX;
+    if( 2 * offset > view.mBoatVel )
+    {
+        return 1;
+    }
+    if( -2 * offset > view.mBoatVel )
+    {
+        return -1;
+    }
+    return 0;
+}
+
+BoatController *CreateBoatController( BoatControllerType type )
+{
+    switch( type )
+    {
+        case CONTROLLER_KEYBOARD: return new KeyboardController();
+        case CONTROLLER_CHASE: return new ChaseController();
+        case CONTROLLER_INTERCEPT: return new InterceptController();
+    }
+    return NULL;
+}
+
+BoatController *CreateHeadlessController( const GameConfig &config_ )
+{
+    return CreateBoatController( config_.mController == CONTROLLER_KEYBOARD ? CONTROLLER_INTERCEPT : config_.mController );
+}
+
+bool ParseBoatController( const char *name, BoatControllerType *type )
+{
+    if( strcmp( name, "keyboard" ) == 0 )
+    {
+        *type = CONTROLLER_KEYBOARD;
+    }
+    else if( strcmp( name, "chase" ) == 0 )
+    {
+        *type = CONTROLLER_CHASE;
+    }
+    else if( strcmp( name, "intercept" ) == 0 )
+    {
+        *type = CONTROLLER_INTERCEPT;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
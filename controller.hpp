@@ -0,0 +1,64 @@
+//
+//  controller.hpp
+//  Game
+//
+//  Boat controllers: every tick a controller looks at a read-only view of the world
+//  and commands the boat velocity. The simulation turns the commands into key presses,
+//  so controlled games are recorded and replayed like keyboard games.
+//
+
+#ifndef controller_h
+#define controller_h
+
+#include "simulation.hpp"
+
+//Decides the boat velocity every tick
+class BoatController
+{
+public:
+    virtual ~BoatController();
+    //Returns the boat velocity for the coming tick: -1 left, 0 stop, 1 right
+    virtual int Update( const WorldView &view ) = 0;
+};
+
+//The player: the boat moves while an arrow key is held (both keys cancel out)
+class KeyboardController: public BoatController
+{
+public:
+    //Constructor: Initializes the variables
+    KeyboardController();
+    //Presses and releases a key
+    void KeyDown( BoatKey key );
+    void KeyUp( BoatKey key );
+    //Sets the keys held (a sampled keyboard state)
+    void SetKeys( bool left, bool right );
+    int Update( const WorldView &view );
+    
+private:
+    bool mLeft, mRight; //keys held
+};
+
+//Moves the boat center under the parachutist that is lowest on the screen
+class ChaseController: public BoatController
+{
+public:
+    int Update( const WorldView &view );
+};
+
+//Predicts the tick and X offset every parachutist lands at, skips the ones the boat can not reach in time
+//and moves to the one that lands first - positioned towards the one landing after it when there is room.
+//One pass over the parachutists, no allocations.
+class InterceptController: public BoatController
+{
+public:
+    int Update( const WorldView &view );
+};
+
+//Creates a controller of the given type (the caller deletes it)
+BoatController *CreateBoatController( BoatControllerType type );
+//Creates the controller of a run without a window - there is no keyboard, the intercept controller plays instead
+BoatController *CreateHeadlessController( const GameConfig &config_ );
+//Parses a controller name ("keyboard", "chase" or "intercept") - returns false for an unknown name
+bool ParseBoatController( const char *name, BoatControllerType *type );
+
+#endif /* controller_h */
@@ -6,62 +6,233 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL_image.h>
 #include <stdexcept>
 #include <stdlib.h>//use of rand
+#include <string.h>//use of memcpy
 #include <sstream>
 #include <algorithm> // use of for_each
 
 #include "game.hpp"
+#include "loader.hpp"
+#include "image.hpp"
+#include "golden.hpp"
 
-LTexture::LTexture(Game *mGamePtr_): mTexture(NULL), mWidth(0), mHeight(0), mGamePtr(mGamePtr_)
+TextureCache::TextureCache(Game *mGamePtr_): mGamePtr(mGamePtr_), mHits(0), mMisses(0)
 {}
 
-LTexture::~LTexture()
+TextureCache::~TextureCache()
 {
-     SDL_DestroyTexture( mTexture );
+    Clear();
 }
 
-bool LTexture::loadFromFile( std::string path )
+CachedTexture* TextureCache::Acquire( const std::string &path, int width, int height )
 {
-    std::string errormsg;
-	//The final texture
-	SDL_Texture* newTexture = NULL;
+    //Return the cached texture if the asset was already loaded
+    std::string key = GetAssetKey( path, width, height );
+    std::map<std::string, CachedTexture>::iterator it = mTextures.find( key );
+    if( it != mTextures.end() )
+    {
+        ++mHits;
+        ++it->second.mRefCount;
+        return &it->second;
+    }
+    
+    CachedTexture *cached = Upload( key, DecodeImage( path, width, height ), width > 0 && height > 0 );
+    cached->mRefCount = 1;
+    return cached;
+}
 
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
-	if( loadedSurface == NULL )
-	{
-        throw std::runtime_error("Unable to load image! SDL_image Error");
+void TextureCache::Add( const std::string &path, int width, int height, SDL_Surface *surface_ )
+{
+    std::string key = GetAssetKey( path, width, height );
+    if( mTextures.find( key ) != mTextures.end() )
+    {
+        SDL_FreeSurface( surface_ );
+        return;
     }
-   
-    //Color key image
-    SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
+    
+    //Nobody uses the texture yet - the first Acquire takes the first reference
+    Upload( key, surface_, width > 0 && height > 0 )->mRefCount = 0;
+}
 
+void TextureCache::AddPixels( const std::string &key, int width, int height, const void *pixels_, int pitch, Uint32 format, bool opaque )
+{
+    std::string errormsg;
+    if( mTextures.find( key ) != mTextures.end() )
+    {
+        return;
+    }
+    
+    //Upload the pixels as they are - no surface in between
+    SDL_Texture* newTexture = SDL_CreateTexture( mGamePtr->GetRenderer(), format, SDL_TEXTUREACCESS_STATIC, width, height );
+    if( newTexture == NULL || SDL_UpdateTexture( newTexture, NULL, pixels_, pitch ) < 0 )
+    {
+        SDL_DestroyTexture( newTexture );
+        errormsg = "Unable to create texture from pixels! SDL Error: %s\n";
+        errormsg.append(SDL_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    SDL_SetTextureBlendMode( newTexture, opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND );
+    
+    ++mMisses;
+    Store( key, newTexture, width, height );
+}
+
+CachedTexture* TextureCache::Upload( const std::string &key, SDL_Surface *surface_, bool opaque )
+{
+    std::string errormsg;
+    ++mMisses;
+    
     //Create texture from surface pixels
-    newTexture = SDL_CreateTextureFromSurface( mGamePtr->GetRenderer(), loadedSurface );
+    SDL_Texture* newTexture = SDL_CreateTextureFromSurface( mGamePtr->GetRenderer(), surface_ );
     if( newTexture == NULL )
     {
+        SDL_FreeSurface( surface_ );
         errormsg = "Unable to create texture from %s! SDL Error: %s\n";
         errormsg.append(SDL_GetError());
         throw std::runtime_error(errormsg.c_str());
     }
-		
-    //Get image dimensions
-    mWidth = loadedSurface->w;
-    mHeight = loadedSurface->h;
-		
+    
+    //Resampled layers are opaque - no blending when they are drawn
+    if( opaque )
+    {
+        SDL_SetTextureBlendMode( newTexture, SDL_BLENDMODE_NONE );
+    }
+    
+    CachedTexture *cached = Store( key, newTexture, surface_->w, surface_->h );
 
     //Get rid of old loaded surface
-    SDL_FreeSurface( loadedSurface );
-	
+    SDL_FreeSurface( surface_ );
+    
+    return cached;
+}
+
+CachedTexture* TextureCache::Store( const std::string &key, SDL_Texture *texture_, int width, int height )
+{
+    //Store the texture and its dimensions
+    CachedTexture &cached = mTextures[key];
+    cached.mTexture = texture_;
+    cached.mWidth = width;
+    cached.mHeight = height;
+    cached.mRefCount = 0;
+    return &cached;
+}
+
+void TextureCache::Release( CachedTexture *texture_ )
+{
+    if( --texture_->mRefCount > 0 )
+    {
+        return;
+    }
+    
+    //Nobody uses the texture anymore - destroy it
+    for (std::map<std::string, CachedTexture>::iterator it = mTextures.begin(); it != mTextures.end(); ++it)
+    {
+        if( &it->second == texture_ )
+        {
+            SDL_DestroyTexture( it->second.mTexture );
+            mTextures.erase( it );
+            return;
+        }
+    }
+}
+
+void TextureCache::Clear()
+{
+    for (std::map<std::string, CachedTexture>::iterator it = mTextures.begin(); it != mTextures.end(); ++it)
+    {
+        SDL_DestroyTexture( it->second.mTexture );
+    }
+    mTextures.clear();
+}
+
+unsigned long TextureCache::GetHits() const
+{
+    return(mHits);
+}
+
+unsigned long TextureCache::GetMisses() const
+{
+    return(mMisses);
+}
+
+size_t TextureCache::GetSize() const
+{
+    return(mTextures.size());
+}
+
+LTexture::LTexture(Game *mGamePtr_): mTexture(NULL), mCached(NULL), mAtlas(NULL), mWidth(0), mHeight(0), mGamePtr(mGamePtr_)
+{}
+
+LTexture::~LTexture()
+{
+    free();
+}
+
+void LTexture::free()
+{
+    if( mCached != NULL )
+    {
+        //Shared texture - let the cache decide when to destroy it
+        mGamePtr->GetTextureCache().Release( mCached );
+        mCached = NULL;
+    }
+    else if( mAtlas == NULL )
+    {
+        SDL_DestroyTexture( mTexture );
+    }
+    mAtlas = NULL;
+    mTexture = NULL;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+bool LTexture::loadFromFile( std::string path )
+{
+    //Get rid of preexisting texture
+    free();
+    
+    //Get the texture from the cache (loaded from disk only once per asset)
+    mCached = mGamePtr->GetTextureCache().Acquire( path );
+    mTexture = mCached->mTexture;
+    mWidth = mCached->mWidth;
+    mHeight = mCached->mHeight;
 
 	//Return success
-	mTexture = newTexture;
 	return mTexture != NULL;
 }
 
+bool LTexture::loadScaledFromFile( std::string path, int width, int height )
+{
+    //Get rid of preexisting texture
+    free();
+    
+    //Get the resampled texture from the cache (loaded and resampled only once)
+    mCached = mGamePtr->GetTextureCache().Acquire( path, width, height );
+    mTexture = mCached->mTexture;
+    mWidth = mCached->mWidth;
+    mHeight = mCached->mHeight;
+
+	//Return success
+	return mTexture != NULL;
+}
+
+void LTexture::loadFromAtlas( const SpriteAtlas &atlas, const SDL_Rect &region )
+{
+    //Get rid of preexisting texture
+    free();
+    
+    mAtlas = &atlas;
+    mTexture = atlas.getTexture();
+    mClip = region;
+    mWidth = region.w;
+    mHeight = region.h;
+}
 
 bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor )
 {
     std::string errormsg;
+    
+    //Get rid of preexisting texture
+    free();
 
 	//Render text surface
 	SDL_Surface* textSurface = TTF_RenderText_Solid( mGamePtr->GetFont(), textureText.c_str(), textColor );
@@ -95,6 +266,21 @@ bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColo
 void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip, bool should_streach) const 
 {
 	SDL_Rect renderQuad = { x, y, mWidth, mHeight };	
+	
+	//An atlas view draws its own region of the atlas (a clip is relative to the region)
+	SDL_Rect atlasClip;
+	if( mAtlas != NULL )
+	{
+		atlasClip = mClip;
+		if( clip != NULL )
+		{
+			atlasClip.x += clip->x;
+			atlasClip.y += clip->y;
+			atlasClip.w = clip->w;
+			atlasClip.h = clip->h;
+		}
+		clip = &atlasClip;
+	}
 
 	//Set rendering space and render to screen
 	if (should_streach)
@@ -119,8 +305,15 @@ void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* ce
 		}
 	}
 
-	//Render to screen
-	SDL_RenderCopyEx( mGamePtr->GetRenderer(), mTexture, clip, &renderQuad, angle, center, flip );
+	//Render to screen - the rotation path only when the texture is transformed
+	if( angle == 0.0 && flip == SDL_FLIP_NONE )
+	{
+		SDL_RenderCopy( mGamePtr->GetRenderer(), mTexture, clip, &renderQuad );
+	}
+	else
+	{
+		SDL_RenderCopyEx( mGamePtr->GetRenderer(), mTexture, clip, &renderQuad, angle, center, flip );
+	}
 }
 
 int LTexture::getWidth() const
@@ -133,208 +326,82 @@ int LTexture::getHeight() const
 	return mHeight;
 }
 
-
-AnimatedItem::AnimatedItem(Game *mGamePtr_, int PosX_, int PosY_, int Vel_, int VelX_, int VelY_, bool Alive_) :
-                                            mGamePtr(mGamePtr_),
-                                            mTexture(mGamePtr_),
-                                            mPosX(PosX_), //Initialize the offsets
-								  			mPosY(PosY_), 
-											mVel(Vel_), //Initialize the Max Velocity
-											mVelX(VelX_), //Initialize the velocity
-											mVelY(VelY_), //Initialize the velocity
-                                            mAlive(Alive_)
-{}
-
-
-//return Position Y of AnimatedItem
-int AnimatedItem::GetPosY() const
-{
-	return(mPosY);
-}
-
-//return Position X of AnimatedItem
-int AnimatedItem::GetPosX() const
-{
-	return(mPosX);
-}
-
-//return velocity of AnimatedItem
-int AnimatedItem::GetVel() const
-{
-	return(mVel);
-}
-
-//return width of AnimatedItem
-int AnimatedItem::GetWidth() const
-{
-	return(mTexture.getWidth());
-}
-
-//return height of AnimatedItem
-int AnimatedItem::GetHeight() const
-{
-	return(mTexture.getHeight());
-}
-
-
-void AnimatedItem::render() const 
-{
-    //Show the item on the screen
-	mTexture.render( mPosX, mPosY );
-}
-
-bool AnimatedItem::IsAlive() const
+SDL_Texture* LTexture::getTexture() const
 {
-    return(mAlive);
+	return mTexture;
 }
 
-Boat::Boat(Game *mGamePtr_): AnimatedItem(mGamePtr_, 0, 400, 10)
+SDL_Rect LTexture::getClip() const
 {
- 
-	//Load Boat texture
-	if( !mTexture.loadFromFile( "boatF.png" ) )
+	if( mAtlas != NULL )
 	{
-        throw std::runtime_error("Failed to load Boat texture!\n");
+		return mClip;
 	}
+	SDL_Rect whole = { 0, 0, mWidth, mHeight };
+	return whole;
 }
 
-void Boat::move()
+int LTexture::getTextureWidth() const
 {
-    //Move the Boat left or right
-    mPosX += mVelX;
-
-    //If the Boat went too far to the left or right
-    if( ( mPosX < 0 ) || ( mPosX + mTexture.getWidth() > SCREEN_WIDTH ) )
-    {
-        //Move back
-        mPosX -= mVelX;
-    }
-
+	return mAtlas != NULL ? mAtlas->getWidth() : mWidth;
 }
 
-void Boat::handleEvent( SDL_Event& e )
+int LTexture::getTextureHeight() const
 {
-    //If a key was pressed
-	if( e.type == SDL_KEYDOWN && e.key.repeat == 0 )
-    {
-        //Adjust the velocity
-        switch( e.key.keysym.sym )
-        {
-            case SDLK_LEFT: mVelX -= mVel; break;
-            case SDLK_RIGHT: mVelX += mVel; break;
-        }
-    }
-    //If a key was released
-    else if( e.type == SDL_KEYUP && e.key.repeat == 0 )
-    {
-        //Adjust the velocity
-        switch( e.key.keysym.sym )
-        {
-            case SDLK_LEFT: mVelX += mVel; break;
-            case SDLK_RIGHT: mVelX -= mVel; break;
-        }
-    }
+	return mAtlas != NULL ? mAtlas->getHeight() : mHeight;
 }
 
-//Airplane constructor 
-Airplane::Airplane(Game *mGamePtr_): AnimatedItem(mGamePtr_,240, 10, 10), mGameptr(mGamePtr_)
-{
-	//Load Boat texture
-	if( !mTexture.loadFromFile( "airplaneF.png" ) )
-	{
-        throw std::runtime_error("Failed to load airplane texture!\n");
-	}
-
-	mJumpXPos = rand() %  SCREEN_WIDTH; // save a random location when the parashutist will jump
-}
 
-void Airplane::move()
-{
-    //Move the airplane to the left 
-    mPosX -= mVel;
-	
-    //if airplane reached to the location of the parachutist jump
-    if((mPosX >= mJumpXPos) && (mPosX < (mJumpXPos + mVel)) ) // taking into account position move in  mVel jumps
-    {
-    	mGameptr->createParachutist(mJumpXPos); // make the parachutist jump
-    }
-
-    //If the airplane exit the screen from the left
-    if( (mPosX + mTexture.getWidth() ) < 0 ) 
-    {
-        //Move back to the right of the screen
-        mPosX = SCREEN_WIDTH;	
-        mJumpXPos = rand() %  SCREEN_WIDTH; // save a random location when the parashutist will jump
-    }
-}
-
-//
-Parachutist::Parachutist(Game *mGamePtr_, int PosX_): AnimatedItem(mGamePtr_, PosX_, 0, 4)
-{
-	//Load parachutist texture
-	if( !mTexture.loadFromFile( "parachutistF.png" ) )
-	{
-         throw std::runtime_error("Failed to load parachutist texture!\n");
-	}
-}
-
-void Parachutist::Move()
-{
-    //Move the parachutist down and to the left 
-    mPosY += mVel;
-    mPosX -= (mVel / 4);
-}
-
-
-//return Height of Parachutist
-int Parachutist::GetHeight() const
-{
-	return(mTexture.getHeight());
-}
-
-class GameOver: public AnimatedItem
-{
-public:
-    //Constructor: Initializes the variables
-    GameOver(Game *mGameptr_);
-    //Moves the airplane
-    void Move();
-    void Run();
-};
+//Constructor for class Game
+Game::Game( const GameConfig &config_ ):
+                mConfig(config_),
+                mStartTime(std::chrono::steady_clock::now()),
+                mOffscreen(NULL),
+                mTextureCache(this),
+                mBackgroundTexture(this),
+                mSpriteAtlas(this),
+                mReplay(config_.mReplayPath != NULL ? new InputReplay( config_.mReplayPath ) : NULL),
+                mSimulation(mReplay != NULL ? mReplay->GetConfig( config_ ) : config_),
+                mRecorder(NULL),
+                mAutopilot(config_.mRenderBench ? CreateHeadlessController( config_ ) :
+                           config_.mController != CONTROLLER_KEYBOARD ? CreateBoatController( config_.mController ) : NULL),
+                mTelemetry(NULL),
+                mFontAtlas(this),
+                mHudText(mFontAtlas),
+                mHudScore(0),
+                mHudLife(-1),
+                mFrameTarget(NULL),
+                mDirtyRegion(SCREEN_WIDTH, SCREEN_HEIGHT),
+                mFullRedraw(true),
+                mDirtyFraction(0.0),
+                mDirtyFractionSum(0.0),
+                mDirtyFractionMax(0.0),
+                mCapture(NULL),
+                mKeySequence(0),
+                mKeyboardInput(1), // no key event, no key held
+                mAppliedSequence(0),
+                mStopSimulation(false),
+                mSimulationFinished(false),
+                mRefreshInterval(std::chrono::microseconds( 1000000 / 60 )),
+                mFrameWork(0),
+                mProfiler(config_.mProfile || config_.mProfileOverlay),
+                mProfilerText(mFontAtlas),
+                mFrameCount(0),
+                mMaxDrawCalls(0)
 
-GameOver::GameOver(Game *mGamePtr_): AnimatedItem(mGamePtr_, SCREEN_WIDTH + 150,  (SCREEN_HEIGHT / 2) - 200 , 40, 0, 0, false)
 {
-
-    //Load Boat texture
-    if( !mTexture.loadFromFile( "gameover.png" ) )
+    std::string errormsg;
+    
+    if( mConfig.mTickRate <= 0 || mConfig.mMaxCatchUpTicks <= 0 )
     {
-       throw std::runtime_error("Failed to load gameover texture!\n");
+        throw std::runtime_error("Tick rate and catch up ticks must be positive!\n");
     }
-}
-
-void GameOver::Move()
-{
     
-    if(mPosX >= ((SCREEN_WIDTH / 2) - (GetWidth() / 2 ) + 25)) // Check if the gameover reach the center of the screen
+    //The render benchmark needs no display - it runs on the dummy video driver
+    if( mConfig.mRenderBench )
     {
-        //Move the gameover to the left
-        mPosX -= mVel;
+        SDL_setenv( "SDL_VIDEODRIVER", "dummy", 1 );
     }
-}
-
-void GameOver::Run()
-{
-    mAlive = true;
-}
-
-//Constructor for class Game
-Game::Game():   mBackgroundTexture(this),
-                mTextTexture(this),
-                mScore(0),
-                mLife(3)
-
-{
-    std::string errormsg;
     
     //Initialize SDL
     if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
@@ -351,15 +418,37 @@ Game::Game():   mBackgroundTexture(this),
     }
     
     //Create window
-    mWindow = SDL_CreateWindow( "Matific Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+    mWindow = SDL_CreateWindow( "Matific Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT,
+                                mConfig.mRenderBench ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN );
     if( mWindow == NULL )
     {
         errormsg = "Window could not be created! SDL Error: %s\n";
         errormsg.append(SDL_GetError());
         throw std::runtime_error(errormsg.c_str());
     }
-    //Create vsynced renderer for window
-    mRenderer = SDL_CreateRenderer( mWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC );
+    
+    //Create renderer for window - vsynced unless rendering is uncapped
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if( mConfig.mVsync )
+    {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    if( mConfig.mRenderBench )
+    {
+        //The render benchmark draws with the software renderer into a surface, the same pixels on every machine
+        mOffscreen = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+        if( mOffscreen == NULL )
+        {
+            errormsg = "Offscreen frame could not be created! SDL Error: %s\n";
+            errormsg.append(SDL_GetError());
+            throw std::runtime_error(errormsg.c_str());
+        }
+        mRenderer = SDL_CreateSoftwareRenderer( mOffscreen );
+    }
+    else
+    {
+        mRenderer = SDL_CreateRenderer( mWindow, -1, rendererFlags );
+    }
     if( mRenderer == NULL )
     {
         errormsg = "Renderer could not be created! SDL Error: %s\n";
@@ -367,8 +456,33 @@ Game::Game():   mBackgroundTexture(this),
         throw std::runtime_error(errormsg.c_str());
     }
     
+    //The refresh the low latency mode schedules the frames for (60 Hz when the display does not tell)
+    SDL_DisplayMode displayMode;
+    if( SDL_GetWindowDisplayMode( mWindow, &displayMode ) == 0 && displayMode.refresh_rate > 0 )
+    {
+        mRefreshInterval = std::chrono::microseconds( 1000000 / displayMode.refresh_rate );
+    }
+    
+    //Capture the frames at the rate they are shown (the render benchmark shows one tick per frame)
+    if( mConfig.mCapturePath != NULL )
+    {
+        int fps = mConfig.mRenderBench ? mConfig.mTickRate : (int)( std::chrono::seconds( 1 ) / mRefreshInterval );
+        mCapture = new FrameCapture( mConfig.mCapturePath, mConfig.mCaptureFormat, SCREEN_WIDTH, SCREEN_HEIGHT, fps );
+    }
+    
     //Initialize renderer color
     SDL_SetRenderDrawColor( mRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+    mRenderQueue.SetRenderer( mRenderer );
+    
+    //Partial redraws compose the frame in a render target - without render target support every frame is drawn whole
+    if( mConfig.mDirtyRects )
+    {
+        mFrameTarget = SDL_CreateTexture( mRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT );
+        if( mFrameTarget == NULL )
+        {
+            printf( "Partial redraws disabled, no render target! SDL Error: %s\n", SDL_GetError() );
+        }
+    }
             
     //Initialize PNG loading
     int imgFlags = IMG_INIT_PNG;
@@ -387,14 +501,36 @@ Game::Game():   mBackgroundTexture(this),
         throw std::runtime_error(errormsg.c_str());
     }
     
-    //Load background texture
-    if( !mBackgroundTexture.loadFromFile( "background.bmp" ) )
+    //Use the asset bundle when there is one: its images are decoded already and the textures
+    //are created straight from the mapped pixels. Otherwise the images are decoded on worker threads
+    //while the font is opened and the loading frame is shown.
+    AssetLoader loader;
+    if( mBundle.Open( mConfig.mBundlePath ) )
     {
-        throw std::runtime_error("Failed to load background texture image!\n" );
+        for( unsigned int i = 0; i < mBundle.GetEntryCount(); ++i )
+        {
+            const BundleEntry &entry = mBundle.GetEntry( i );
+            if( entry.mType == BUNDLE_IMAGE )
+            {
+                mTextureCache.AddPixels( entry.mName, entry.mWidth, entry.mHeight, mBundle.GetData( entry ), entry.mPitch, entry.mFormat,
+                                         ( entry.mFlags & BUNDLE_OPAQUE ) != 0 );
+            }
+        }
+    }
+    else
+    {
+        loader.Request( BACKGROUND_PATH, SCREEN_WIDTH, SCREEN_HEIGHT ); //resampled once to the screen size (it is a 1920x1080 image)
+        for( int i = 0; i < SPRITE_COUNT; ++i )
+        {
+            loader.Request( SPRITES[i].mPath );
+        }
+        loader.Start();
     }
             
-    //Open the font
-    mFont = TTF_OpenFont( "hand.ttf", 22 );
+    //Open the font (read from the mapped bundle when it has it - the bundle outlives the font)
+    const BundleEntry *fontEntry = mBundle.IsOpen() ? mBundle.Find( FONT_PATH ) : NULL;
+    SDL_RWops *fontFile = fontEntry != NULL ? SDL_RWFromConstMem( mBundle.GetData( *fontEntry ), (int)fontEntry->mSize ) : SDL_RWFromFile( FONT_PATH, "rb" );
+    mFont = TTF_OpenFontRW( fontFile, 1, 22 );
     if( mFont == NULL )
     {
         errormsg =  "Failed to load font! SDL_ttf Error: %s\n";
@@ -402,10 +538,72 @@ Game::Game():   mBackgroundTexture(this),
         throw std::runtime_error(errormsg.c_str());
     }
     
-    //Create the animated items
-    mBoat = new Boat(this);
-    mAirplane = new Airplane(this);
-    mGameOver = new GameOver(this);
+    //Rasterise the font glyphs once for all HUD text
+    SDL_Color textColor = { 0, 0, 0, 0xFF };
+    mFontAtlas.load( mFont, textColor );
+    
+    //Show a loading frame right away, then create the textures as the images are decoded
+    if( !loader.IsDone() )
+    {
+        RenderLoadingFrame( loader );
+        printf( "Loading frame after %.1f ms\n", std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - mStartTime ).count() );
+        while( !loader.IsDone() )
+        {
+            if( loader.Upload( mTextureCache, LOADING_WAIT_MS ) > 0 )
+            {
+                RenderLoadingFrame( loader );
+            }
+            SDL_PumpEvents(); // keep the window responsive
+        }
+    }
+    printf( "Assets loaded from %s in %.1f ms\n", mBundle.IsOpen() ? mConfig.mBundlePath : "the asset files",
+            std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - mStartTime ).count() );
+    
+    //Load background texture (already decoded - taken from the texture cache)
+    if( !mBackgroundTexture.loadScaledFromFile( BACKGROUND_PATH, SCREEN_WIDTH, SCREEN_HEIGHT ) )
+    {
+        throw std::runtime_error("Failed to load background texture image!\n" );
+    }
+    
+    //Load the sprite textures once, every item drawn with a sprite shares its texture
+    for( int i = 0; i < SPRITE_COUNT; ++i )
+    {
+        mSpriteTextures[i] = new LTexture(this);
+        if( !mSpriteTextures[i]->loadFromFile( SPRITES[i].mPath ) )
+        {
+            errormsg = "Failed to load sprite texture ";
+            errormsg.append(SPRITES[i].mPath);
+            throw std::runtime_error(errormsg.c_str());
+        }
+        
+        //The simulation uses the sprite metadata - it must match the image
+        if( mSpriteTextures[i]->getWidth() != SPRITES[i].mWidth || mSpriteTextures[i]->getHeight() != SPRITES[i].mHeight )
+        {
+            errormsg = "Sprite metadata does not match the image size of ";
+            errormsg.append(SPRITES[i].mPath);
+            throw std::runtime_error(errormsg.c_str());
+        }
+    }
+    
+    //Pack the sprites into one texture so the sprite layers draw from a single texture
+    if( mSpriteAtlas.build( mSpriteTextures, SPRITE_COUNT ) )
+    {
+        printf( "Sprite atlas: %d sprites in %dx%d\n", SPRITE_COUNT, mSpriteAtlas.getWidth(), mSpriteAtlas.getHeight() );
+    }
+    
+    //Record the key transitions of the game
+    if( mConfig.mRecordPath != NULL )
+    {
+        mRecorder = new InputRecorder( mConfig.mRecordPath, mReplay != NULL ? mReplay->GetConfig( mConfig ) : mConfig );
+        mSimulation.SetInputRecorder( mRecorder );
+    }
+    
+    //Export the live telemetry
+    if( mConfig.mTelemetryTarget != NULL )
+    {
+        mTelemetry = new Telemetry( mConfig.mTelemetryTarget, mConfig.mTelemetryFormat );
+        mSimulation.SetTelemetry( mTelemetry );
+    }
 }
 
 
@@ -416,148 +614,675 @@ void Game::Run()
 
 	//Event handler
 	SDL_Event e;
+    
+    //Fixed timestep: the simulation runs mTickRate ticks per second whatever the frame rate is
+    const Uint64 tickLength = SDL_GetPerformanceFrequency() / mConfig.mTickRate;
+    Uint64 previousTime = SDL_GetPerformanceCounter();
+    Uint64 accumulator = 0; //time not simulated yet
+    
+    //Run the ticks on a thread of their own (--sim-thread)
+    unsigned long lastTick = 0; //tick of the state drawn by the last frame
+    if( mConfig.mSimulationThread )
+    {
+        StartSimulationThread();
+    }
 
     //While application is running
     while( !quit )
     {
+        mProfiler.BeginFrame();
+        WaitForFrameStart();
+        mWorkStart = std::chrono::steady_clock::now();
+        
         //Handle events on queue
-        while( SDL_PollEvent( &e ) != 0 )
         {
-            //User requests quit
-            if( e.type == SDL_QUIT )
+            ProfileScope scope( mProfiler, PHASE_EVENTS );
+            while( SDL_PollEvent( &e ) != 0 )
             {
-                quit = true;
+                //User requests quit
+                if( e.type == SDL_QUIT )
+                {
+                    quit = true;
+                }
+                //The renderer lost the contents of the render targets - copy the sprites into the atlas again
+                //and compose the next frame from scratch
+                if( e.type == SDL_RENDER_TARGETS_RESET )
+                {
+                    mSpriteAtlas.rebuild();
+                    mFullRedraw = true;
+                }
+                //Handle input for the Boat
+                HandleEvent( e );
             }
-            //Handle input for the Boat
-                mBoat->handleEvent( e );
+            SampleKeyboard();
         }
+        
+        Uint64 currentTime = SDL_GetPerformanceCounter();
+        Uint64 frameTime = currentTime - previousTime; // since the same point of the last frame
+        accumulator += frameTime;
+        previousTime = currentTime;
+        
+        int ticks = 0;
+        double alpha = 0.0;
+        const RenderState *state = &mRenderState;
+        if( mSimulationThread.joinable() )
+        {
+            //The simulation thread runs the ticks - draw the newest state it published
+            PublishKeyboard();
+            bool finished = mSimulationFinished.load( std::memory_order_acquire ); // the last state is published before
+            mPublished.Update();
+            const PublishedState &published = mPublished.GetFront();
+            state = &published.mWorld;
+            ticks = (int)( published.mWorld.mTick - lastTick );
+            lastTick = published.mWorld.mTick;
+            if( published.mInputSequence == mKeySequence )
+            {
+                mInputLatency.Applied(); // every key event read so far is in the state
+            }
+            alpha = std::min( 1.0, std::chrono::duration<double>( std::chrono::steady_clock::now() - published.mTickTime ).count() * mConfig.mTickRate );
+            if( finished )
+            {
+                quit = true; // a replay ends with its recording
+            }
+        }
+        else
+        {
+            //Run the ticks that are due, but not more than the catch up limit
+            {
+                ProfileScope scope( mProfiler, PHASE_SIMULATION );
+                while( accumulator >= tickLength && ticks < mConfig.mMaxCatchUpTicks && !( mReplay != NULL && mReplay->IsFinished( mSimulation ) ) )
+                {
+                    Tick();
+                    accumulator -= tickLength;
+                    ++ticks;
+                }
+            }
+            
+            //Too far behind (e.g. the window was dragged) - drop the time instead of spiralling
+            if( accumulator >= tickLength )
+            {
+                accumulator %= tickLength;
+            }
             
-        //check if the game is over
-        if(mGameOver->IsAlive())
+            //A replay ends with its recording
+            if( mReplay != NULL && mReplay->IsFinished( mSimulation ) )
+            {
+                quit = true;
+            }
+            
+            mSimulation.GetRenderState( mRenderState );
+            alpha = (double)accumulator / tickLength;
+        }
+        
+        //Render all game elements between the last two ticks (a replay shows the ticks themselves so its frames are reproducible)
+        Render( *state, mReplay != NULL ? 1.0 : alpha );
+        
+        mProfiler.EndFrame( ticks, state->mParachutistCount );
+        
+        //The simulation thread records to the telemetry itself - a ring takes one producer thread only
+        if( mTelemetry != NULL && !mSimulationThread.joinable() )
         {
-            mGameOver->Move(); //display game over animation
+            mTelemetry->Record( TELEMETRY_FRAME, state->mTick, (int32_t)( frameTime * 1000000 / SDL_GetPerformanceFrequency() ), ticks,
+                                (int32_t)state->mParachutistCount );
+        }
+    }
+    StopSimulationThread();
+    
+    printf( "Simulated %lu ticks in %lu frames\n", mSimulation.GetTickCount(), mFrameCount );
+    printf( "Parachutist pool: %u of %u slots used at most, %lu dropped\n", mSimulation.GetParachutists().GetHighWaterMark(),
+            mSimulation.GetParachutists().GetCapacity(), mSimulation.GetParachutists().GetDropped() );
+    if( mConfig.mBroadPhase )
+    {
+        printf( "Broad phase: %lu boat floor tests avoided\n", mSimulation.GetTestsAvoided() );
+    }
+    printf( "Draw calls: %.1f per frame, %u at most\n", mFrameCount ? (double)mRenderQueue.GetDrawCalls() / mFrameCount : 0.0, mMaxDrawCalls );
+    mInputLatency.Print( stdout );
+    PrintCaptureStats();
+    if( mTelemetry != NULL )
+    {
+        mTelemetry->Close();
+        printf( "Telemetry: %lu records exported, %lu dropped\n", mTelemetry->GetWritten(), mTelemetry->GetDropped() );
+    }
+    if( mFrameTarget != NULL )
+    {
+        printf( "Partial redraws: %.1f%% of the pixels per frame, %.1f%% at most\n", mFrameCount ? 100.0 * mDirtyFractionSum / mFrameCount : 0.0,
+                100.0 * mDirtyFractionMax );
+    }
+    
+    if( mRecorder != NULL )
+    {
+        mRecorder->Finish( mSimulation );
+        printf( "Recorded %lu key transitions to %s\n", mRecorder->GetCount(), mConfig.mRecordPath );
+    }
+    if( mReplay != NULL )
+    {
+        printf( "Replay %s the recording\n", mReplay->Verify( mSimulation ) ? "matches" : "DOES NOT match" );
+    }
+    
+    if( mProfiler.IsEnabled() )
+    {
+        printf( "Frame time: p50 %.2f ms, p99 %.2f ms over the last %u frames\n", mProfiler.GetFramePercentile( 50.0 ),
+                mProfiler.GetFramePercentile( 99.0 ), mProfiler.GetFrameCount() );
+        if( mProfiler.WriteCsv( mConfig.mProfileCsv ) )
+        {
+            printf( "Frame profile written to %s\n", mConfig.mProfileCsv );
         }
         else
         {
-            Move(); //Move all game elements
+            printf( "Could not write the frame profile to %s\n", mConfig.mProfileCsv );
         }
-        //Render all game elements
-        Render();
     }
 }
 
+bool Game::RunRenderBench()
+{
+    //One tick per frame and no interpolation, so every run draws exactly the same frames
+    std::vector<GoldenFrame> frames;
+    frames.reserve( mConfig.mRenderBenchFrames );
+    std::chrono::steady_clock::duration renderTime( 0 );
+    while( frames.size() < mConfig.mRenderBenchFrames && !( mReplay != NULL && mReplay->IsFinished( mSimulation ) ) )
+    {
+        mWorkStart = std::chrono::steady_clock::now();
+        Tick();
+        
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mSimulation.GetRenderState( mRenderState );
+        Render( mRenderState, 1.0 );
+        renderTime += std::chrono::steady_clock::now() - start;
+        
+        GoldenFrame frame;
+        frame.mScene = HashRenderState( mRenderState );
+        frame.mPixels = HashFrame();
+        frame.mHasPixels = true;
+        frames.push_back( frame );
+    }
+    
+    double seconds = std::chrono::duration<double>( renderTime ).count();
+    printf( "Rendered %lu frames in %.3f s (%.0f frames/s, render only)\n", (unsigned long)frames.size(), seconds,
+            seconds > 0 ? frames.size() / seconds : 0.0 );
+    printf( "Draw calls: %.1f per frame, %u at most\n", mFrameCount ? (double)mRenderQueue.GetDrawCalls() / mFrameCount : 0.0, mMaxDrawCalls );
+    PrintCaptureStats();
+    
+    //The pixels are only comparable on the SDL version that drew them
+    SDL_version version;
+    SDL_GetVersion( &version );
+    char renderer[64];
+    snprintf( renderer, sizeof(renderer), "SDL %d.%d.%d software renderer", version.major, version.minor, version.patch );
+    return FinishGoldenCheck( mConfig, frames, renderer );
+}
+
+uint64_t Game::HashFrame() const
+{
+    //FNV-1a over the pixel rows, 8 bytes at a time (the row padding is left out)
+    uint64_t hash = 14695981039346656037ULL;
+    if( SDL_MUSTLOCK( mOffscreen ) )
+    {
+        SDL_LockSurface( mOffscreen );
+    }
+    size_t rowSize = (size_t)mOffscreen->w * mOffscreen->format->BytesPerPixel;
+    for( int y = 0; y < mOffscreen->h; ++y )
+    {
+        const unsigned char *row = (const unsigned char *)mOffscreen->pixels + (size_t)y * mOffscreen->pitch;
+        size_t x = 0;
+        for( ; x + sizeof(uint64_t) <= rowSize; x += sizeof(uint64_t) )
+        {
+            uint64_t word;
+            memcpy( &word, row + x, sizeof(word) );
+            hash = ( hash ^ word ) * 1099511628211ULL;
+        }
+        for( ; x < rowSize; ++x )
+        {
+            hash = ( hash ^ row[x] ) * 1099511628211ULL;
+        }
+    }
+    if( SDL_MUSTLOCK( mOffscreen ) )
+    {
+        SDL_UnlockSurface( mOffscreen );
+    }
+    return(hash);
+}
 
-bool Parachutist::IsOutOfRange(const Parachutist *parachutist_)
+void Game::Tick()
 {
-	//If the parachutist reach the bottom
-	return (parachutist_->mPosY - parachutist_->GetHeight() ) > SCREEN_HEIGHT ;
+    //A replay presses the recorded keys instead of the controller
+    if( mReplay != NULL )
+    {
+        mReplay->Update( mSimulation );
+    }
+    else if( mAutopilot != NULL )
+    {
+        mSimulation.SetBoatCommand( mAutopilot->Update( mSimulation.GetWorldView() ) );
+    }
+    else if( mConfig.mSimulationThread )
+    {
+        //The keyboard command the render thread published last (see PublishKeyboard)
+        uint64_t input = mKeyboardInput.load( std::memory_order_acquire );
+        mSimulation.SetBoatCommand( (int)( input & 3 ) - 1 );
+        mAppliedSequence = input >> 2;
+    }
+    else
+    {
+        mSimulation.SetBoatCommand( mKeyboard.Update( mSimulation.GetWorldView() ) );
+        mInputLatency.Applied(); // the key events read so far are in this tick
+    }
+    
+    if( mTelemetry == NULL )
+    {
+        mSimulation.Tick();
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mSimulation.Tick();
+    mTelemetry->Record( TELEMETRY_TICK, mSimulation.GetTickCount(),
+                        (int32_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count(),
+                        (int32_t)mSimulation.GetParachutists().GetCount() );
 }
 
-//check if the parachutist collides with the boat
-inline bool Game::BoatParachutistCollision(Boat *boat, Parachutist *parachutist) const 
+void Game::HandleEvent( const SDL_Event &e )
 {
-    return ((   //Checking if the parachutist reach in at the range of the Y position of the boat floor
-                (boat->GetPosY() + boat->GetHeight() * 0.9)   >= // calculating boat floor Y offset
-                (parachutist->GetPosY()+ parachutist->GetHeight()) ) && // parachutist's feet Y offset
-				// Same check but this time checking the Veocity "jumps" into account
-                ((boat->GetPosY() + boat->GetHeight() * 0.9) <  ( parachutist->GetPosY()+ parachutist->GetHeight() + parachutist->GetVel() ) ) &&
-                // checking the X position of the the parachutist legs is within the range of the boat floor
-				( boat->GetPosX() <= parachutist->GetPosX() + (parachutist->GetWidth() *  0.625 )) &&
-				( (boat->GetPosX() + boat->GetWidth()) >= (parachutist->GetPosX() + (parachutist->GetWidth() *  0.375 ) ))
-				);
+    //Only the first press or release of a key matters, the boat follows the held keys on the next tick
+    if( ( e.type != SDL_KEYDOWN && e.type != SDL_KEYUP ) || e.key.repeat != 0 )
+    {
+        return;
+    }
+    
+    BoatKey key;
+    switch( e.key.keysym.sym )
+    {
+        case SDLK_LEFT: key = BOAT_KEY_LEFT; break;
+        case SDLK_RIGHT: key = BOAT_KEY_RIGHT; break;
+        default: return;
+    }
+    
+    //Follow the event to the screen when the keyboard drives the boat (the event timestamps are in milliseconds)
+    if( mAutopilot == NULL && mReplay == NULL )
+    {
+        Uint32 now = SDL_GetTicks();
+        mInputLatency.KeyEvent( SDL_TICKS_PASSED( now, e.key.timestamp ) ? now - e.key.timestamp : 0 );
+        ++mKeySequence;
+    }
+    
+    //The low latency mode reads the held keys instead (see SampleKeyboard)
+    if( mConfig.mLowLatency )
+    {
+        return;
+    }
+    
+    if( e.type == SDL_KEYDOWN )
+    {
+        mKeyboard.KeyDown( key );
+    }
+    else
+    {
+        mKeyboard.KeyUp( key );
+    }
+}
 
+void Game::StartSimulationThread()
+{
+    //The first frame draws the state before the first tick
+    PublishedState &initial = mPublished.GetBack();
+    mSimulation.GetRenderState( initial.mWorld );
+    initial.mTickTime = std::chrono::steady_clock::now();
+    initial.mInputSequence = 0;
+    mPublished.Publish();
+    mPublished.Update();
+    
+    PublishKeyboard();
+    mSimulationThread = std::thread( &Game::SimulationLoop, this );
 }
-void Game::Move()
+
+void Game::StopSimulationThread()
 {
-	//Move the animated items
-	mBoat->move();
-	mAirplane->move();
+    if( mSimulationThread.joinable() )
+    {
+        mStopSimulation.store( true, std::memory_order_release );
+        mSimulationThread.join();
+    }
+}
 
-	//Go through all parachutists that alive currently
-	for (std::vector<Parachutist *>::iterator it = mParachutist.begin(); it != mParachutist.end(); ++it)
-	{
-        //Move each instance of the parachutists
-		(*it)->Move();
-		
-        if( ( ((*it)->GetPosY() + (*it)->GetHeight()) > (mBoat->GetPosY() + mBoat->GetHeight() * 0.9) ) &&
-           
-           ( ((*it)->GetPosY() + (*it)->GetHeight())  <= (mBoat->GetPosY() + mBoat->GetHeight() * 0.9) +(*it)->GetVel())
-           ) // check if Parachutist passed the boat
+void Game::SimulationLoop()
+{
+    //Fixed timestep as in Run, but the thread sleeps until the next tick is due instead of waiting for a frame
+    const std::chrono::steady_clock::duration tickLength =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::seconds( 1 ) ) / mConfig.mTickRate;
+    std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now() + tickLength;
+    
+    while( !mStopSimulation.load( std::memory_order_acquire ) )
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        int ticks = 0;
+        while( nextTick <= now && ticks < mConfig.mMaxCatchUpTicks && !( mReplay != NULL && mReplay->IsFinished( mSimulation ) ) )
         {
-
-            if (mLife == 0)
-            {
-                mGameOver->Run();
-            }
-            else
-            {
-                mLife -= 1;
-            }
+            Tick();
+            nextTick += tickLength;
+            ++ticks;
         }
         
-        // delete Parachutist from vector if the parachutist pass the bottom of the screen or touch the boat
-		if(((*it)->GetPosY() - (*it)->GetHeight()) > SCREEN_HEIGHT) // check if Parachutist passed the bottom of the screen
-		{
-			it = mParachutist.erase(it) - 1;
-            		}
-		else if (BoatParachutistCollision(mBoat, *it) )		{
-			it = mParachutist.erase(it) - 1;
-			mScore += 10;
-		}
+        //Too far behind - drop the time instead of spiralling
+        if( nextTick <= now )
+        {
+            nextTick = now + tickLength - ( now - nextTick ) % tickLength;
+        }
+        
+        //Publish the state of the ticks for the render thread
+        if( ticks > 0 )
+        {
+            PublishedState &published = mPublished.GetBack();
+            mSimulation.GetRenderState( published.mWorld );
+            published.mTickTime = nextTick - tickLength;
+            published.mInputSequence = mAppliedSequence;
+            mPublished.Publish();
+        }
+        
+        //A replay ends with its recording
+        if( mReplay != NULL && mReplay->IsFinished( mSimulation ) )
+        {
+            mSimulationFinished.store( true, std::memory_order_release );
+            return;
+        }
+        
+        std::this_thread::sleep_until( nextTick );
+    }
+}
 
-	}
+void Game::PublishKeyboard()
+{
+    //Key events read so far and the command of the held keys in one word, so the simulation thread sees them together
+    //(the keyboard controller does not look at the world)
+    mKeyboardInput.store( ( mKeySequence << 2 ) | (uint64_t)( mKeyboard.Update( WorldView() ) + 1 ), std::memory_order_release );
 }
-void Game::Render() 
+
+void Game::WaitForFrameStart()
 {
-	//Clear screen
-	SDL_SetRenderDrawColor( mRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
-	SDL_RenderClear( mRenderer );
+    //Sleeping only pays off when the present waits for the refresh
+    if( !mConfig.mLowLatency || !mConfig.mVsync || mFrameCount == 0 )
+    {
+        return;
+    }
+    
+    //Start late enough that the input is fresh, early enough that the frame is presented before the refresh
+    std::chrono::steady_clock::time_point start = mLastPresent + mRefreshInterval - mFrameWork - LOW_LATENCY_MARGIN;
+    long long wait = std::chrono::duration_cast<std::chrono::milliseconds>( start - std::chrono::steady_clock::now() ).count();
+    if( wait > 0 )
+    {
+        SDL_Delay( (Uint32)wait );
+    }
+}
 
-	//Render background texture to screen
-	mBackgroundTexture.render( 0, 0 , 0 , 0 , 0 , SDL_FLIP_NONE, true);
+void Game::SampleKeyboard()
+{
+    if( !mConfig.mLowLatency )
+    {
+        return;
+    }
+    
+    //The events were just pumped - the state is the keys held right before the ticks
+    const Uint8 *keys = SDL_GetKeyboardState( NULL );
+    mKeyboard.SetKeys( keys[SDL_SCANCODE_LEFT] != 0, keys[SDL_SCANCODE_RIGHT] != 0 );
+}
 
-	//Render objects
-	for (std::vector<Parachutist *>::iterator it = mParachutist.begin(); it != mParachutist.end(); ++it)
+void Game::RenderItem( SpriteId sprite, int layer, int posX, int posY, int prevPosX, int prevPosY, double alpha )
+{
+    int x = posX, y = posY;
+    int dx = posX - prevPosX, dy = posY - prevPosY;
+    
+    //Interpolate between the last two ticks unless the item jumped (e.g. airplane wrapping around)
+    if( abs( dx ) < SCREEN_WIDTH / 2 && abs( dy ) < SCREEN_HEIGHT / 2 )
+    {
+        x = prevPosX + (int)( dx * alpha );
+        y = prevPosY + (int)( dy * alpha );
+    }
+    
+    //Show the item on the screen
+    mRenderQueue.Push( layer, GetSpriteTexture( sprite ), x, y );
+}
+
+void Game::RenderItem( SpriteId sprite, int layer, const ItemState &item, double alpha )
+{
+    RenderItem( sprite, layer, item.mPosX, item.mPosY, item.mPrevPosX, item.mPrevPosY, alpha );
+}
+
+void Game::Render( const RenderState &state, double alpha ) 
+{
+	//Rebuild the text that changed
+	{
+		ProfileScope scope( mProfiler, PHASE_TEXT );
+		TextUpdate( state );
+		if( mConfig.mProfileOverlay )
 		{
-			(*it)->render();
+			ProfilerTextUpdate();
+		}
+	}
+	
+	{
+		ProfileScope scope( mProfiler, PHASE_RENDER );
+		
+		//Clear screen - optional, the opaque background covers the whole frame (a partial redraw keeps the last frame)
+		if( mConfig.mClearFrame && mFrameTarget == NULL )
+		{
+			SDL_SetRenderDrawColor( mRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+			SDL_RenderClear( mRenderer );
 		}
 
-	mBoat->render();
-	mAirplane->render();
-	TextUpdate();
-	//Render Text
-	mTextTexture.render( 20, 40 );
-    mGameOver->render();
+		//Render background texture to screen (already at the screen size - a 1:1 copy)
+		mRenderQueue.Push( LAYER_BACKGROUND, mBackgroundTexture, 0, 0 );
 
-	//Update screen - please note that Vsync take care of stablizing the frame rate and syncing it to screen refresh rate.
-	SDL_RenderPresent( mRenderer );
+		//Render objects
+		for( unsigned int i = 0; i < state.mParachutistCount; ++i )
+		{
+			RenderItem( SPRITE_PARACHUTIST, LAYER_PARACHUTISTS, state.mParachutistPosX[i], state.mParachutistPosY[i],
+			            state.mParachutistPrevPosX[i], state.mParachutistPrevPosY[i], alpha );
+		}
+
+		RenderItem( SPRITE_BOAT, LAYER_BOAT, state.mBoat, alpha );
+		for( size_t i = 0; i < state.mAirplanes.size(); ++i )
+		{
+			RenderItem( SPRITE_AIRPLANE, LAYER_AIRPLANE, state.mAirplanes[i], alpha );
+		}
+		//Render Text
+		mHudText.render( mRenderQueue, LAYER_HUD );
+		if( mConfig.mProfileOverlay )
+		{
+			mProfilerText.render( mRenderQueue, LAYER_HUD );
+		}
+		if( state.mGameOver.mAlive )
+		{
+			RenderItem( SPRITE_GAMEOVER, LAYER_GAMEOVER, state.mGameOver, alpha );
+		}
+		
+		//Submit the frame's draws batched by layer and texture
+		if( mFrameTarget != NULL )
+		{
+			FlushDirty();
+		}
+		else
+		{
+			mRenderQueue.Flush();
+		}
+		if( mRenderQueue.GetLastDrawCalls() > mMaxDrawCalls )
+		{
+			mMaxDrawCalls = mRenderQueue.GetLastDrawCalls();
+		}
+	}
+
+	//Read the finished frame back for the capture before it is presented
+	if( mCapture != NULL )
+	{
+		ProfileScope scope( mProfiler, PHASE_CAPTURE );
+		CaptureFrame();
+	}
+	
+	//Keep the longest recent frame work, forgetting a slow frame over a few frames
+	std::chrono::steady_clock::duration work = std::chrono::steady_clock::now() - mWorkStart;
+	mFrameWork = std::max( work, mFrameWork - mFrameWork / 16 );
+	
+	//Update screen - the game speed does not depend on the frame rate (see Game::Run)
+	{
+		ProfileScope scope( mProfiler, PHASE_PRESENT );
+		SDL_RenderPresent( mRenderer );
+		
+		//Low latency: wait until the renderer finished the frame (reading a pixel back syncs with it),
+		//so no frame is queued in the driver and the next frame's input is not shown a refresh late
+		if( mConfig.mLowLatency )
+		{
+			SDL_Rect pixelRect = { 0, 0, 1, 1 };
+			Uint32 pixel;
+			SDL_RenderReadPixels( mRenderer, &pixelRect, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel) );
+		}
+	}
+	mLastPresent = std::chrono::steady_clock::now();
+	mInputLatency.Presented();
+	if( mFrameCount == 0 )
+	{
+		printf( "Time to first frame: %.1f ms\n", std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - mStartTime ).count() );
+	}
+	++mFrameCount;
 }
 
-void Game::createParachutist(int PosX_)
+void Game::CaptureFrame()
 {
-	mParachutist.push_back(new Parachutist(this, PosX_));
+	//No free buffer - the writer is behind, drop the frame without reading it back
+	void *pixels = mCapture->Acquire();
+	if( pixels == NULL )
+	{
+		return;
+	}
+	SDL_Rect frameRect = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	if( SDL_RenderReadPixels( mRenderer, &frameRect, SDL_PIXELFORMAT_ARGB8888, pixels, mCapture->GetPitch() ) == 0 )
+	{
+		mCapture->Submit();
+	}
+	else
+	{
+		mCapture->Cancel();
+	}
 }
 
-void Game::TextUpdate()
+void Game::PrintCaptureStats()
 {
-	std::stringstream scoretext;
-    std::string errormsg;
-	scoretext << "Score: " << mScore << " Life: " <<mLife;
+	if( mCapture == NULL )
+	{
+		return;
+	}
+	mCapture->Close();
+	printf( "Capture: %lu frames written to %s, %lu dropped\n", mCapture->GetWritten(), mConfig.mCapturePath, mCapture->GetDropped() );
+}
 
-	//Render text
-	SDL_Color textColor = { 0, 0, 0 };
-	if( !mTextTexture.loadFromRenderedText( scoretext.str() , textColor ) )
+void Game::FlushDirty()
+{
+	//Redraw where anything above the background changed - the background and whatever overlaps those parts is drawn again, clipped
+	mRenderQueue.CollectDirty( mDirtyRegion, LAYER_PARACHUTISTS );
+	if( mFullRedraw )
 	{
-        errormsg =  "Failed to render text texture!\n";
-        errormsg.append(SDL_GetError());
-        throw std::runtime_error(errormsg.c_str());
+		mDirtyRegion.AddAll();
+		mFullRedraw = false;
+	}
+	
+	SDL_SetRenderTarget( mRenderer, mFrameTarget );
+	mRenderQueue.Flush( &mDirtyRegion.GetRects() );
+	SDL_SetRenderTarget( mRenderer, NULL );
+	
+	//The back buffer does not keep its pixels between presents - copy the whole composed frame
+	SDL_RenderCopy( mRenderer, mFrameTarget, NULL, NULL );
+	
+	mDirtyFraction = mDirtyRegion.GetFraction();
+	mDirtyFractionSum += mDirtyFraction;
+	if( mDirtyFraction > mDirtyFractionMax )
+	{
+		mDirtyFractionMax = mDirtyFraction;
 	}
+	mDirtyRegion.Clear();
+}
+
+void Game::RenderLoadingFrame( const AssetLoader &loader )
+{
+	SDL_SetRenderDrawColor( mRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderClear( mRenderer );
+	
+	std::stringstream loadingtext;
+	loadingtext << "Loading " << loader.GetUploadedCount() << "/" << loader.GetRequestCount();
+	TextLabel loadingLabel( mFontAtlas );
+	loadingLabel.setText( loadingtext.str(), SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 );
+	loadingLabel.render( mRenderQueue, LAYER_HUD );
+	mRenderQueue.Flush();
+	
+	SDL_RenderPresent( mRenderer );
+}
+
+void Game::TextUpdate( const RenderState &state )
+{
+    //The HUD only changes when the score or the life changes
+    if( state.mScore == mHudScore && state.mLife == mHudLife )
+    {
+        return;
+    }
+    mHudScore = state.mScore;
+    mHudLife = state.mLife;
+    
+	std::stringstream scoretext;
+	scoretext << "Score: " << mHudScore << " Life: " << mHudLife;
+	mHudText.setText( scoretext.str(), 20, 40 );
+}
+
+void Game::ProfilerTextUpdate()
+{
+    //Percentiles sort the recorded frames - refresh the overlay twice a second, not every frame
+    const unsigned long refreshFrames = 30;
+    if( mFrameCount % refreshFrames != 0 )
+    {
+        return;
+    }
+    
+    const FrameSample &last = mProfiler.GetLastFrame();
+    std::stringstream profilertext;
+    profilertext.setf( std::ios::fixed );
+    profilertext.precision( 2 );
+    profilertext << "Frame: " << last.mFrameTime / 1000.0 << " ms p50: " << mProfiler.GetFramePercentile( 50.0 )
+                 << " p99: " << mProfiler.GetFramePercentile( 99.0 ) << " Sim: " << mProfiler.GetPhaseAverage( PHASE_SIMULATION )
+                 << " Render: " << mProfiler.GetPhaseAverage( PHASE_RENDER ) << " Parachutists: " << last.mEntities;
+    if( mFrameTarget != NULL )
+    {
+        profilertext << " Redrawn: " << 100.0 * mDirtyFraction << "%";
+    }
+    mProfilerText.setText( profilertext.str(), 20, 80 );
 }
 Game::~Game()
 {
+    //The simulation thread uses the game - stop it first (Run stops it too, unless it threw)
+    StopSimulationThread();
+    
+    //Release the textures
+    mSpriteAtlas.free();
+    for( int i = 0; i < SPRITE_COUNT; ++i )
+    {
+        delete mSpriteTextures[i];
+    }
+    mBackgroundTexture.free();
+    mFontAtlas.free();
+    
+    //Close the input logs
+    delete mRecorder;
+    delete mReplay;
+    delete mAutopilot;
+    delete mTelemetry;
+    delete mCapture;
+    
+    printf( "Texture cache: %lu hits, %lu misses\n", mTextureCache.GetHits(), mTextureCache.GetMisses() );
+    
+    //Destroy the cached textures while the renderer still exists
+    mTextureCache.Clear();
+    if( mFrameTarget != NULL )
+    {
+        SDL_DestroyTexture( mFrameTarget );
+    }
 
 	//Destroy window	
 	SDL_DestroyRenderer( mRenderer );
+	if( mOffscreen != NULL )
+	{
+		SDL_FreeSurface( mOffscreen );
+	}
 	SDL_DestroyWindow( mWindow );
 
 	//Quit SDL subsystems
@@ -583,4 +1308,21 @@ TTF_Font* Game::GetFont() const
     return(mFont);
 }
 
+//Returns the game texture cache
+TextureCache& Game::GetTextureCache()
+{
+    return(mTextureCache);
+}
+
+//Returns the texture of a sprite
+const LTexture& Game::GetSpriteTexture( SpriteId sprite ) const
+{
+    //Drawn from the atlas when there is one
+    if( mSpriteAtlas.isBuilt() )
+    {
+        return(mSpriteAtlas.getSprite( sprite ));
+    }
+    return(*mSpriteTextures[sprite]);
+}
+
 
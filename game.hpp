@@ -14,24 +14,109 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <map>
+#include <chrono>
+#include <atomic>
+#include <thread>
 
+#include "config.hpp"
+#include "simulation.hpp"
+#include "text.hpp"
+#include "render.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "bundle.hpp"
+#include "atlas.hpp"
+#include "controller.hpp"
+#include "telemetry.hpp"
+#include "latency.hpp"
+#include "capture.hpp"
+#include "triplebuffer.hpp"
 
-//Screen dimension constants
-const int SCREEN_WIDTH = 1040;
-const int SCREEN_HEIGHT = 680;
 
 //forward declaration of all classes
+struct CachedTexture;
+class TextureCache;
 class LTexture;
 class LTimer;
 class Game;
-class AnimatedItem;
-class Boat;
-class Airplane;
-class Parachutist;
-class GameOver;
+class AssetLoader;
+class SpriteAtlas;
+
+//Longest wait for a decoded image before the loading frame is redrawn
+const unsigned int LOADING_WAIT_MS = 16;
+//Low latency mode: time left between the end of a frame's work and the refresh it is meant for
+const std::chrono::milliseconds LOW_LATENCY_MARGIN( 2 );
+
+//A state the simulation thread published for the render thread (--sim-thread)
+struct PublishedState
+{
+    RenderState mWorld; //what the frame draws
+    std::chrono::steady_clock::time_point mTickTime; //when the last tick of the state was due (for the interpolation)
+    uint64_t mInputSequence; //key events the ticks of the state applied
+};
 
 // to do add const to everywhere
 
+//A texture loaded from an asset file and shared by every LTexture that uses the asset
+struct CachedTexture
+{
+    SDL_Texture* mTexture; //The actual hardware texture
+    int mWidth; //Image width
+    int mHeight; //Image height
+    int mRefCount; //How many LTexture objects currently share the texture
+};
+
+//Cache of asset textures keyed by path, every asset is decoded and uploaded only once
+class TextureCache
+{
+public:
+    //Initializes variables
+    TextureCache(Game *mGamePtr_);
+    
+    //Destroys all cached textures
+    ~TextureCache();
+    
+    //Returns the texture of the asset at path, loading it from disk only on the first request.
+    //With a size the image is resampled once to that size into an opaque texture (for full screen layers).
+    CachedTexture* Acquire( const std::string &path, int width = 0, int height = 0 );
+    
+    //Adds an image decoded ahead of time (e.g. by the AssetLoader), the cache takes the surface.
+    //A later Acquire of the same path and size gets its texture without touching the disk.
+    void Add( const std::string &path, int width, int height, SDL_Surface *surface_ );
+    //Adds a texture made straight from pixels in memory (e.g. a mapped asset bundle) under an asset key (see GetAssetKey)
+    void AddPixels( const std::string &key, int width, int height, const void *pixels_, int pitch, Uint32 format, bool opaque );
+    
+    //Drops a reference to a cached texture, the texture is destroyed when nobody uses it
+    void Release( CachedTexture *texture_ );
+    
+    //Destroys all cached textures (must be called before the renderer is destroyed)
+    void Clear();
+    
+    //Cache statistics
+    unsigned long GetHits() const;
+    unsigned long GetMisses() const;
+    size_t GetSize() const;
+    
+private:
+    
+    TextureCache( const TextureCache &other_); //disable copy constructor
+    
+    //Creates the texture of a decoded image and stores it without any reference (takes the surface)
+    CachedTexture* Upload( const std::string &key, SDL_Surface *surface_, bool opaque );
+    //Stores a texture without any reference
+    CachedTexture* Store( const std::string &key, SDL_Texture *texture_, int width, int height );
+    
+    // pointer to game
+    Game *mGamePtr;
+    //Loaded textures by asset path
+    std::map<std::string, CachedTexture> mTextures;
+    
+    //Statistics
+    unsigned long mHits; //requests served from the cache
+    unsigned long mMisses; //assets loaded from disk
+};
+
 //Texture wrapper class
 class LTexture
 {
@@ -42,25 +127,49 @@ public:
     //Deallocates memory
     ~LTexture();
     
-    //Loads image at specified path
+    //Loads image at specified path (through the game texture cache)
     bool loadFromFile( std::string path );
+    
+    //Loads an opaque image resampled once to the given size (through the game texture cache)
+    bool loadScaledFromFile( std::string path, int width, int height );
+    
+    //Releases the texture
+    void free();
+
+    //Makes the texture a view of a region of a sprite atlas (the atlas keeps the texture)
+    void loadFromAtlas( const SpriteAtlas &atlas, const SDL_Rect &region );
 
     //Creates image from font string
     bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
     
-    //Renders texture at given point
+    //Renders texture at given point (an atlas view draws its region unless a clip is given)
     void render( int x, int y, SDL_Rect* clip = NULL, double angle = 0.0, SDL_Point* center = NULL, SDL_RendererFlip flip = SDL_FLIP_NONE, bool should_streach = false) const;
     
     //Gets image dimensions
     int getWidth() const;
     int getHeight() const;
     
+ 
+    //Gets the hardware texture
+    SDL_Texture* getTexture() const;
+    
+    //Part of the hardware texture the image covers (the whole texture unless it is an atlas view)
+    SDL_Rect getClip() const;
+    //Gets the hardware texture dimensions
+    int getTextureWidth() const;
+    int getTextureHeight() const;
+    
 private:
    
     // pointer to game
     Game *mGamePtr;
     //The actual hardware texture
     SDL_Texture* mTexture;
+    //The cache entry the texture belongs to (NULL when the texture is owned, e.g. rendered text)
+    CachedTexture* mCached;
+    //The atlas the texture is a region of (NULL when the image has its own texture)
+    const SpriteAtlas* mAtlas;
+    SDL_Rect mClip; //region of the atlas
     
     //Image dimensions
     int mWidth;
@@ -68,128 +177,141 @@ private:
     
 };
 
-class AnimatedItem
-{
-public:
-    //Constructor: Initializes the variables
-    AnimatedItem(Game *mGamePtr_, int PosX_, int PosY_, int Vel_ = 10, int VelX_ = 0, int VelY_ = 0, bool Alive_ = true);
-    //Shows the item on the screen
-    void render() const;
-    //return position Y of animated item
-    int GetPosY() const;
-    //return position X of animated item
-    int GetPosX() const;
-    //return velocity of animated item
-    int GetVel() const;
-    //return width of animated item
-    int GetWidth() const;
-    //return height of animated item
-    int GetHeight() const;
-    //check is Item is alive (for parachutists and gameover)
-    bool IsAlive() const;
-    
-    
-protected:
-    Game *mGamePtr; // pointer to game (in order to access renderer and window pointers)
-    LTexture mTexture; 	// Item's texture
-    int mPosX, mPosY; //The X and Y offsets of the item
-    int mVel; //Maximum axis velocity of the Item
-    int mVelX, mVelY; 	//The velocity of the item by axis
-    bool mAlive = true; // set if the item is visiable and active (for parachutist and gameover)
-    
-private:
-    AnimatedItem(AnimatedItem &other_); //disable copy constructor
-};
-
-class Boat: public AnimatedItem
-{
-public:
-    //Constructor: Initializes the variables
-    Boat(Game *mGamePtr_);
-    //Takes key presses and adjusts the Boat's velocity
-    void handleEvent( SDL_Event& e );
-    //Moves the item
-    void move();
-};
-
-class Airplane: public AnimatedItem
-{
-public:
-    //Constructor: Initializes the variables
-    Airplane(Game *mGameptr_);
-    //Moves the airplane
-    void move();
-    
-private:
-    Game *mGameptr; // pointer to game object - to be able to call createParachutist method
-    int mJumpXPos; // X Position of the parashutist jump
-    
-};
-
-class Parachutist: public AnimatedItem
-{
-public:
-    //Constructor: Initializes the variables
-    Parachutist(Game *mGmaePtr_, int PosX_);
-    //Moves the airplane
-    void Move();
-    //return the Parachutist Height
-    int GetHeight() const;
-    //Check if the Parachusist is out of the screen
-    static bool IsOutOfRange(const Parachutist *parachutist_);
-};
-
 //The main class that holds all assests and renderable items
 class Game
 {
 public:
     //Constructor: Initializes the variables
-    Game();
+    Game( const GameConfig &config_ = GameConfig() );
     //Destructor: release all of the class assets
     ~Game();
     // Starting the game main loop
     void Run();
-    // Render all elements in the game
-    void Render();
-    //Moves all animated object and check parachutist location and kill it if needed
-    void Move();
+    // Draw one tick per frame offscreen (software renderer), report the render frame rate and
+    // compare the frame hashes with the golden ones - returns false when a frame differs
+    bool RunRenderBench();
+    // Advance the game by one fixed simulation tick
+    void Tick();
+    // Render all elements of a state, interpolated by alpha between its last two ticks
+    void Render( const RenderState &state, double alpha = 1.0 );
     //Returns the game window pointer
     SDL_Window* GetWindow() const;
     //Returns the Game renderer pointer
     SDL_Renderer* GetRenderer() const;
     //Returns the game font pointer
     TTF_Font *GetFont() const;
+    //Returns the game texture cache
+    TextureCache &GetTextureCache();
+    //Returns the texture of a sprite
+    const LTexture &GetSpriteTexture( SpriteId sprite ) const;
     
 private:
     
     Game( const Game &other_); //disable copy constructor
     
+    GameConfig mConfig; //run options
+    std::chrono::steady_clock::time_point mStartTime; //construction time (for the time to first frame)
+    
+    //Asset bundle (when there is one) - must outlive the font that reads from it
+    AssetBundle mBundle;
+    
     //General assets members
     SDL_Window* mWindow; //The window we'll be rendering to
     SDL_Renderer* mRenderer; //The window renderer
+    SDL_Surface* mOffscreen; //The frame the render benchmark draws into (NULL = the window is drawn)
     TTF_Font *mFont = NULL; //Globally used font
     
+    //Texture cache - must be declared before any LTexture member
+    TextureCache mTextureCache;
+    
     //General game textures
     LTexture mBackgroundTexture;
-    LTexture mTextTexture;
+    LTexture *mSpriteTextures[SPRITE_COUNT]; //one texture per sprite, shared by all items drawn with it
+    SpriteAtlas mSpriteAtlas; //all sprite textures in one texture (when the renderer can build it)
+    
+    //Input log played instead of the keyboard (NULL = live input) - must be declared before mSimulation
+    InputReplay *mReplay;
+    
+    //The game logic and all animated items
+    Simulation mSimulation;
+    
+    //Input log the key transitions are recorded to (NULL = no recording)
+    InputRecorder *mRecorder;
+    
+    //What drives the boat when no input log is played
+    KeyboardController mKeyboard; //the arrow keys
+    BoatController *mAutopilot; //AI controller playing instead of the keyboard (NULL = the keyboard plays)
+    
+    //Live telemetry of the frames, ticks and game events (NULL = no telemetry)
+    Telemetry *mTelemetry;
+    
+    //HUD text drawn from the font glyph atlas
+    GlyphAtlas mFontAtlas; //all glyphs of the game font in one texture
+    TextLabel mHudText; //score and life text
+    unsigned int mHudScore; //score shown by mHudText
+    int mHudLife; //life shown by mHudText (-1 until the text is first built)
+    
+    //Draws of the frame, sorted and batched by texture
+    RenderQueue mRenderQueue;
+    
+    //Partial redraws (--dirty-rects): the frame is composed in a render target that keeps its pixels between frames
+    SDL_Texture *mFrameTarget; //the composed frame (NULL when the whole frame is drawn every time)
+    DirtyRegion mDirtyRegion; //parts of the frame redrawn this frame
+    bool mFullRedraw; //set when the render target lost its contents
+    double mDirtyFraction; //part of the frame redrawn by the last frame
+    double mDirtyFractionSum; //parts of the frame redrawn by all frames (for the average)
+    double mDirtyFractionMax; //largest part of the frame redrawn by a frame
+    
+    //Gameplay capture the rendered frames are written to (NULL = no capture)
+    FrameCapture *mCapture;
+    
+    //What the frames draw
+    RenderState mRenderState; //copied from the simulation every frame when the ticks run on this thread
+    
+    //Simulation thread (--sim-thread): it runs the ticks and publishes their states, the render thread draws
+    //the newest one - the two threads only share atomics and the triple buffer
+    TripleBuffer<PublishedState> mPublished; //states of the simulation thread
+    uint64_t mKeySequence; //key events read by the render thread
+    std::atomic<uint64_t> mKeyboardInput; //key events read (times 4) and the keyboard command + 1, for the simulation thread
+    uint64_t mAppliedSequence; //key events the simulation thread applied (simulation thread only)
+    std::atomic<bool> mStopSimulation; //set to end the simulation thread
+    std::atomic<bool> mSimulationFinished; //set by the simulation thread at the end of a replay
+    std::thread mSimulationThread;
+    
+    //Time from each key event to the first frame that shows it
+    InputLatency mInputLatency;
     
+    //Low latency mode (--low-latency): frames start as late as the work of the last frames allows
+    std::chrono::steady_clock::duration mRefreshInterval; //time between two display refreshes
+    std::chrono::steady_clock::duration mFrameWork; //longest recent frame from its start to the present (decays)
+    std::chrono::steady_clock::time_point mWorkStart; //start of the current frame's work
+    std::chrono::steady_clock::time_point mLastPresent; //end of the last present
     
-    //AnimatedItems
-    Boat *mBoat; // pointer to a boat
-    friend Airplane;
-    Airplane *mAirplane; //pointer to airplane
-    std::vector<Parachutist *> mParachutist; //vector to hold the possible multiple instances of parachutist
-    GameOver *mGameOver; //animation for gameover;
+    //Frame phase timings (only recorded with --profile)
+    FrameProfiler mProfiler;
+    TextLabel mProfilerText; //frame time overlay (--profile-overlay)
     
-    //Score members
-    unsigned int mScore; //keeps the game score
-    int mLife; //keeps how many lives have left in the game
+    //Loop statistics
+    unsigned long mFrameCount; //frames rendered
+    unsigned int mMaxDrawCalls; //most draw calls in a frame
     
     //Methods
-    void createParachutist(int PosX_); // create a new Parachutist
-    void removeParachutist(); // remove a new Parachutist
-    bool BoatParachutistCollision(Boat *boat, Parachutist *parachutist) const;
-    void TextUpdate(); //update the text texture from the current score
+    void HandleEvent( const SDL_Event &e ); // pass keyboard input to the keyboard controller
+    void WaitForFrameStart(); // low latency mode: sleep until the latest start that still makes the next refresh
+    void SampleKeyboard(); // low latency mode: set the keyboard controller from the keys held now
+    void StartSimulationThread(); // publish the first state and start the simulation thread
+    void StopSimulationThread();
+    void SimulationLoop(); // simulation thread: run the ticks when they are due and publish their states
+    void PublishKeyboard(); // hand the keyboard command to the simulation thread
+    void RenderItem( SpriteId sprite, int layer, int posX, int posY, int prevPosX, int prevPosY, double alpha ); // queue an item between its last two positions
+    void RenderItem( SpriteId sprite, int layer, const ItemState &item, double alpha );
+    void FlushDirty(); //draw the changed parts of the frame into the render target and copy it to the screen
+    uint64_t HashFrame() const; //hash of the pixels of the offscreen frame
+    void CaptureFrame(); //read the frame back into a capture buffer and queue it for the capture writer
+    void PrintCaptureStats(); //close the capture and print how many frames it wrote
+    void TextUpdate( const RenderState &state ); //rebuild the HUD text when the score or life changed
+    void RenderLoadingFrame( const AssetLoader &loader ); //draw the loading progress while the assets load
+    void ProfilerTextUpdate(); //rebuild the frame time overlay a few times per second
 };
 
 
@@ -0,0 +1,160 @@
+//
+//  golden.cpp
+//  Game
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "golden.hpp"
+#include "simulation.hpp"
+
+//FNV-1a over the values of a frame
+static void HashValue( uint64_t &hash, int64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+    {
+        hash ^= (uint64_t)( value >> ( 8 * i ) ) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void HashItem( uint64_t &hash, const ItemState &item )
+{
+    HashValue( hash, item.mPosX );
+    HashValue( hash, item.mPosY );
+    HashValue( hash, item.mAlive );
+}
+
+uint64_t HashRenderState( const RenderState &state )
+{
+    uint64_t hash = 14695981039346656037ULL;
+    HashValue( hash, state.mScore );
+    HashValue( hash, state.mLife );
+    HashItem( hash, state.mBoat );
+    HashItem( hash, state.mGameOver );
+    HashValue( hash, (int64_t)state.mAirplanes.size() );
+    for( size_t i = 0; i < state.mAirplanes.size(); ++i )
+    {
+        HashItem( hash, state.mAirplanes[i] );
+    }
+    HashValue( hash, state.mParachutistCount );
+    for( unsigned int i = 0; i < state.mParachutistCount; ++i )
+    {
+        HashValue( hash, state.mParachutistPosX[i] );
+        HashValue( hash, state.mParachutistPosY[i] );
+    }
+    return(hash);
+}
+
+//Reads golden frames (a scene hash and a pixel hash or - per line, # starts a comment) - returns false if the file can not be read
+static bool ReadGoldenFrames( const char *path, std::vector<GoldenFrame> &frames )
+{
+    FILE *file = fopen( path, "r" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    char line[128];
+    while( fgets( line, sizeof(line), file ) != NULL )
+    {
+        if( line[0] == '#' || line[0] == '\n' )
+        {
+            continue;
+        }
+        GoldenFrame frame;
+        char *end = NULL;
+        frame.mScene = strtoull( line, &end, 16 );
+        while( *end == ' ' )
+        {
+            ++end;
+        }
+        frame.mHasPixels = *end != '-' && *end != '\n' && *end != '\0';
+        frame.mPixels = frame.mHasPixels ? strtoull( end, NULL, 16 ) : 0;
+        frames.push_back( frame );
+    }
+    fclose( file );
+    return true;
+}
+
+//Writes golden frames - returns false if the file can not be written
+static bool WriteGoldenFrames( const char *path, const std::vector<GoldenFrame> &frames, const GameConfig &config, const char *renderer_ )
+{
+    FILE *file = fopen( path, "w" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    fprintf( file, "# render benchmark frame hashes: seed %llu, scenario %s, %lu frames\n", (unsigned long long)config.mSeed,
+             config.mScenarioName, (unsigned long)frames.size() );
+    fprintf( file, "# scene hash, pixel hash - pixels: %s\n", renderer_ != NULL ? renderer_ : "none (written headless)" );
+    for( size_t i = 0; i < frames.size(); ++i )
+    {
+        if( frames[i].mHasPixels )
+        {
+            fprintf( file, "%016llx %016llx\n", (unsigned long long)frames[i].mScene, (unsigned long long)frames[i].mPixels );
+        }
+        else
+        {
+            fprintf( file, "%016llx -\n", (unsigned long long)frames[i].mScene );
+        }
+    }
+    return fclose( file ) == 0;
+}
+
+bool FinishGoldenCheck( const GameConfig &config, const std::vector<GoldenFrame> &frames, const char *renderer_ )
+{
+    if( config.mGoldenPath == NULL )
+    {
+        printf( "Golden check skipped (--no-golden)\n" );
+        return true;
+    }
+    if( config.mUpdateGolden )
+    {
+        if( !WriteGoldenFrames( config.mGoldenPath, frames, config, renderer_ ) )
+        {
+            printf( "Could not write the golden hashes to %s\n", config.mGoldenPath );
+            return false;
+        }
+        printf( "Golden hashes of %lu frames written to %s\n", (unsigned long)frames.size(), config.mGoldenPath );
+        return true;
+    }
+    
+    std::vector<GoldenFrame> golden;
+    if( !ReadGoldenFrames( config.mGoldenPath, golden ) )
+    {
+        printf( "Golden check FAILED: could not read the golden hashes from %s (--update-golden writes them, --no-golden skips the check)\n",
+                config.mGoldenPath );
+        return false;
+    }
+    
+    //The scenes always compare, the pixels when both sides drew them
+    unsigned long differ = 0, pixelFrames = 0;
+    for( size_t i = 0; i < frames.size() && i < golden.size(); ++i )
+    {
+        bool comparePixels = frames[i].mHasPixels && golden[i].mHasPixels;
+        pixelFrames += comparePixels ? 1 : 0;
+        if( frames[i].mScene != golden[i].mScene || ( comparePixels && frames[i].mPixels != golden[i].mPixels ) )
+        {
+            if( differ == 0 )
+            {
+                printf( "Frame %lu differs: scene %016llx, golden %016llx", (unsigned long)i, (unsigned long long)frames[i].mScene,
+                        (unsigned long long)golden[i].mScene );
+                if( comparePixels )
+                {
+                    printf( ", pixels %016llx, golden %016llx", (unsigned long long)frames[i].mPixels, (unsigned long long)golden[i].mPixels );
+                }
+                printf( "\n" );
+            }
+            ++differ;
+        }
+    }
+    if( differ > 0 || frames.size() != golden.size() )
+    {
+        printf( "Golden check FAILED: %lu of %lu frames differ, %lu golden frames\n", differ, (unsigned long)frames.size(), (unsigned long)golden.size() );
+        return false;
+    }
+    printf( "Golden check passed: %lu frames match %s, %lu of them with pixel hashes\n", (unsigned long)frames.size(), config.mGoldenPath, pixelFrames );
+    return true;
+}
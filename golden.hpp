@@ -0,0 +1,37 @@
+//
+//  golden.hpp
+//  Game
+//
+//  Golden frame hashes of the render benchmark. Every frame has a scene hash (what the frame shows,
+//  taken from its RenderState - the same on every machine, so headless builds check it too) and a
+//  pixel hash of the frame SDL's software renderer drew (written only by the windowed game, and
+//  only comparable on the SDL version named in the file header).
+//
+
+#ifndef golden_h
+#define golden_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "config.hpp"
+
+struct RenderState;
+
+//Hashes of one frame of the render benchmark
+struct GoldenFrame
+{
+    uint64_t mScene; //HashRenderState of the frame
+    uint64_t mPixels; //hash of the drawn pixels
+    bool mHasPixels; //false when the frame was not drawn (headless)
+};
+
+//Hash of what a frame shows at alpha 1: the HUD values and the sprite positions
+uint64_t HashRenderState( const RenderState &state );
+
+//Ends a render benchmark run: skips the check (--no-golden), writes the hashes to the golden file
+//(--update-golden, renderer_ names what drew the pixels, NULL for none) or compares them with it -
+//returns false when the file can not be read or written, or a frame differs
+bool FinishGoldenCheck( const GameConfig &config, const std::vector<GoldenFrame> &frames, const char *renderer_ );
+
+#endif /* golden_h */
@@ -0,0 +1,82 @@
+//
+//  grid.cpp
+//  Game
+//
+
+#include "grid.hpp"
+
+SpatialGrid::SpatialGrid(int width_, int height_, int cellWidthShift_, int cellHeightShift_):
+                            mCellWidthShift(cellWidthShift_),
+                            mCellHeightShift(cellHeightShift_),
+                            mColumns(((width_ - 1) >> cellWidthShift_) + 1),
+                            mRows(((height_ - 1) >> cellHeightShift_) + 1),
+                            mCellStart(mColumns * mRows + 1, 0)
+{}
+
+unsigned int SpatialGrid::CellOf( int x, int y ) const
+{
+    int column = x < 0 ? 0 : x >> mCellWidthShift;
+    int row = y < 0 ? 0 : y >> mCellHeightShift;
+    if( column >= mColumns )
+    {
+        column = mColumns - 1;
+    }
+    if( row >= mRows )
+    {
+        row = mRows - 1;
+    }
+    return(row * mColumns + column);
+}
+
+void SpatialGrid::Build( const int *x, const int *y, unsigned int count )
+{
+    const unsigned int cells = mColumns * mRows;
+    mEntries.resize( count );
+    mCellOf.resize( count );
+    
+    //Count the points of each cell
+    mCellStart.assign( cells + 1, 0 );
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        mCellOf[i] = CellOf( x[i], y[i] );
+        ++mCellStart[mCellOf[i] + 1];
+    }
+    
+    //Turn the counts into the first entry of each cell
+    for( unsigned int cell = 0; cell < cells; ++cell )
+    {
+        mCellStart[cell + 1] += mCellStart[cell];
+    }
+    
+    //Place the points (mCellStart[cell] is used as the insert position and restored after)
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        mEntries[mCellStart[mCellOf[i]]++] = i;
+    }
+    for( unsigned int cell = cells; cell > 0; --cell )
+    {
+        mCellStart[cell] = mCellStart[cell - 1];
+    }
+    mCellStart[0] = 0;
+}
+
+void SpatialGrid::Query( int x, int y, int w, int h, std::vector<unsigned int> &result ) const
+{
+    unsigned int first = CellOf( x, y );
+    unsigned int last = CellOf( x + w - 1, y + h - 1 );
+    int firstColumn = first % mColumns, lastColumn = last % mColumns;
+    int firstRow = first / mColumns, lastRow = last / mColumns;
+    
+    for( int row = firstRow; row <= lastRow; ++row )
+    {
+        //The cells of a row are next to each other in mEntries
+        unsigned int begin = mCellStart[row * mColumns + firstColumn];
+        unsigned int end = mCellStart[row * mColumns + lastColumn + 1];
+        result.insert( result.end(), mEntries.begin() + begin, mEntries.begin() + end );
+    }
+}
+
+unsigned int SpatialGrid::GetCount() const
+{
+    return((unsigned int)mEntries.size());
+}
@@ -0,0 +1,48 @@
+//
+//  grid.hpp
+//  Game
+//
+//  Uniform grid broad phase over the play field. Entities are inserted as points (an index into
+//  the caller's arrays), a query returns the entities of every cell a rectangle overlaps.
+//  Callers with sized entities grow the query rectangle by the entity extents.
+//  The grid pays off only when a narrow test costs more than a rebuild - the boat floor test does
+//  not, the fused kernel (see kernel.hpp) is faster than the grid path for every parachutist count.
+//
+
+#ifndef grid_h
+#define grid_h
+
+#include <vector>
+
+//Default cell size of the grid as a power of two (128 x 32 pixels) - a point's cell is found with shifts
+const int GRID_CELL_WIDTH_SHIFT = 7;
+const int GRID_CELL_HEIGHT_SHIFT = 5;
+
+class SpatialGrid
+{
+public:
+    //Constructor: covers the field [0, width) x [0, height), points outside are kept in the border cells
+    SpatialGrid(int width_, int height_, int cellWidthShift_ = GRID_CELL_WIDTH_SHIFT, int cellHeightShift_ = GRID_CELL_HEIGHT_SHIFT);
+    
+    //Rebuilds the grid from count points (one counting sort - no allocation once the grid saw count points)
+    void Build( const int *x, const int *y, unsigned int count );
+    
+    //Appends the index of every point in the cells the rectangle overlaps (a superset of the points inside it)
+    void Query( int x, int y, int w, int h, std::vector<unsigned int> &result ) const;
+    
+    //Number of points in the grid
+    unsigned int GetCount() const;
+    
+private:
+    
+    //Cell of a point (clamped to the field)
+    unsigned int CellOf( int x, int y ) const;
+    
+    int mCellWidthShift, mCellHeightShift; //cell size as powers of two
+    int mColumns, mRows; //grid size in cells
+    std::vector<unsigned int> mCellStart; //first entry of each cell in mEntries (one extra at the end)
+    std::vector<unsigned int> mEntries; //point indices sorted by cell
+    std::vector<unsigned int> mCellOf; //cell of each point while building
+};
+
+#endif /* grid_h */
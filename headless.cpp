@@ -0,0 +1,163 @@
+//
+//  headless.cpp
+//  Game
+//
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "headless.hpp"
+#include "replay.hpp"
+#include "telemetry.hpp"
+#include "golden.hpp"
+
+HeadlessGame::HeadlessGame( const GameConfig &config_ ): mConfig(config_)
+{}
+
+bool HeadlessGame::Run()
+{
+    if( mConfig.mRenderBench )
+    {
+        return RunRenderBench();
+    }
+    if( mConfig.mReplayPath != NULL )
+    {
+        return RunReplay();
+    }
+    
+    unsigned long ticks = 0;
+    unsigned long games = 0;
+    unsigned long totalScore = 0;
+    unsigned int highWaterMark = 0;
+    unsigned long testsAvoided = 0;
+    
+    //A recording holds one game
+    InputRecorder *recorder = NULL;
+    if( mConfig.mRecordPath != NULL )
+    {
+        recorder = new InputRecorder( mConfig.mRecordPath, mConfig );
+    }
+    
+    //Live telemetry of the game events - the games run far faster than the drain, the ring drops what it can not hold
+    Telemetry *telemetry = NULL;
+    if( mConfig.mTelemetryTarget != NULL )
+    {
+        telemetry = new Telemetry( mConfig.mTelemetryTarget, mConfig.mTelemetryFormat );
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    //Play games until the requested number of ticks was simulated
+    while( ticks < mConfig.mHeadlessTicks && ( recorder == NULL || games == 0 ) )
+    {
+        //Every game gets its own seed so back to back games differ
+        GameConfig gameConfig = mConfig;
+        gameConfig.mSeed = mConfig.mSeed + games;
+        Simulation sim( gameConfig );
+        sim.SetInputRecorder( recorder );
+        sim.SetTelemetry( telemetry );
+        BoatController *controller = CreateHeadlessController( mConfig );
+        
+        while( !sim.IsGameOver() && ticks < mConfig.mHeadlessTicks )
+        {
+            sim.SetBoatCommand( controller->Update( sim.GetWorldView() ) );
+            sim.Tick();
+            ++ticks;
+        }
+        delete controller;
+        
+        if( recorder != NULL )
+        {
+            recorder->Finish( sim );
+            printf( "Recorded %lu key transitions over %lu ticks to %s\n", recorder->GetCount(), sim.GetTickCount(), mConfig.mRecordPath );
+        }
+        
+        ++games;
+        totalScore += sim.GetScore();
+        testsAvoided += sim.GetTestsAvoided();
+        if( sim.GetParachutists().GetHighWaterMark() > highWaterMark )
+        {
+            highWaterMark = sim.GetParachutists().GetHighWaterMark();
+        }
+    }
+    delete recorder;
+    
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    
+    printf( "Scenario: %s\n", mConfig.mScenarioName );
+    printf( "Simulated %lu ticks in %.3f s (%.0f ticks/s)\n", ticks, seconds, seconds > 0 ? ticks / seconds : 0.0 );
+    printf( "Games: %lu, average score: %.1f\n", games, games > 0 ? (double)totalScore / games : 0.0 );
+    printf( "Parachutist pool: %u of %u slots used at most\n", highWaterMark, mConfig.mMaxParachutists );
+    if( mConfig.mBroadPhase )
+    {
+        printf( "Broad phase: %.2f boat floor tests avoided per tick\n", ticks > 0 ? (double)testsAvoided / ticks : 0.0 );
+    }
+    
+    if( telemetry != NULL )
+    {
+        telemetry->Close();
+        printf( "Telemetry: %lu records exported, %lu dropped\n", telemetry->GetWritten(), telemetry->GetDropped() );
+        delete telemetry;
+    }
+    return true;
+}
+
+bool HeadlessGame::RunReplay()
+{
+    InputReplay replay( mConfig.mReplayPath );
+    Simulation sim( replay.GetConfig( mConfig ) );
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    //Feed the recorded key transitions as fast as possible
+    while( !replay.IsFinished( sim ) )
+    {
+        replay.Update( sim );
+        sim.Tick();
+    }
+    
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    
+    printf( "Replayed %lu ticks in %.3f s (%.0f ticks/s)\n", sim.GetTickCount(), seconds, seconds > 0 ? sim.GetTickCount() / seconds : 0.0 );
+    printf( "Score: %u, life: %d\n", sim.GetScore(), sim.GetLife() );
+    bool matches = replay.Verify( sim );
+    printf( "Replay %s the recording\n", matches ? "matches" : "DOES NOT match" );
+    return(matches);
+}
+
+bool HeadlessGame::RunRenderBench()
+{
+    //The session of Game::RunRenderBench: the replay or the headless controller, one tick per frame
+    InputReplay *replay = mConfig.mReplayPath != NULL ? new InputReplay( mConfig.mReplayPath ) : NULL;
+    Simulation sim( replay != NULL ? replay->GetConfig( mConfig ) : mConfig );
+    BoatController *controller = CreateHeadlessController( mConfig );
+    
+    std::vector<GoldenFrame> frames;
+    frames.reserve( mConfig.mRenderBenchFrames );
+    RenderState state;
+    while( frames.size() < mConfig.mRenderBenchFrames && !( replay != NULL && replay->IsFinished( sim ) ) )
+    {
+        if( replay != NULL )
+        {
+            replay->Update( sim );
+        }
+        else
+        {
+            sim.SetBoatCommand( controller->Update( sim.GetWorldView() ) );
+        }
+        sim.Tick();
+        
+        sim.GetRenderState( state );
+        GoldenFrame frame;
+        frame.mScene = HashRenderState( state );
+        frame.mPixels = 0;
+        frame.mHasPixels = false;
+        frames.push_back( frame );
+    }
+    delete controller;
+    delete replay;
+    
+    printf( "Played %lu render benchmark frames without drawing (scene hashes only)\n", (unsigned long)frames.size() );
+    return FinishGoldenCheck( mConfig, frames, NULL );
+}
@@ -0,0 +1,37 @@
+//
+//  headless.hpp
+//  Game
+//
+//  Runs the simulation without SDL (no window, renderer or assets) as fast as the CPU allows.
+//
+
+#ifndef headless_h
+#define headless_h
+
+#include "config.hpp"
+#include "simulation.hpp"
+#include "controller.hpp"
+
+//Runs back to back games without a window until the requested number of ticks was simulated,
+//or records / replays a single game through an input log
+class HeadlessGame
+{
+public:
+    //Constructor: Initializes the variables
+    HeadlessGame( const GameConfig &config_ = GameConfig() );
+    //Runs the simulation and prints the statistics - returns false if a replay does not match its recording
+    bool Run();
+    
+private:
+    
+    HeadlessGame( const HeadlessGame &other_); //disable copy constructor
+    
+    //Runs the game of the input log - returns true if it ends in the recorded state
+    bool RunReplay();
+    //Plays the render benchmark session without drawing and checks its scene hashes - returns false if a scene differs
+    bool RunRenderBench();
+    
+    GameConfig mConfig; //run options
+};
+
+#endif /* headless_h */
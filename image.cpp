@@ -0,0 +1,62 @@
+//
+//  image.cpp
+//  Game
+//
+
+#include <SDL2/SDL_image.h>
+#include <stdexcept>
+#include <sstream>
+
+#include "image.hpp"
+
+std::string GetAssetKey( const std::string &path, int width, int height )
+{
+    //Resampled images are kept apart from the original image
+    if( width <= 0 || height <= 0 )
+    {
+        return path;
+    }
+    std::stringstream sizeKey;
+    sizeKey << path << "@" << width << "x" << height;
+    return sizeKey.str();
+}
+
+SDL_Surface* DecodeImage( const std::string &path, int width, int height )
+{
+    std::string errormsg;
+    
+	//Load image at specified path
+	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+	if( loadedSurface == NULL )
+	{
+        errormsg = "Unable to load image ";
+        errormsg.append(path);
+        errormsg.append("! SDL_image Error: ");
+        errormsg.append(IMG_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    
+    if( width > 0 && height > 0 )
+    {
+        //Resample the image once so drawing it is a 1:1 copy (linear filtering needs 32 bit pixels)
+        SDL_Surface* sourceSurface = SDL_ConvertSurfaceFormat( loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0 );
+        SDL_FreeSurface( loadedSurface );
+        loadedSurface = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, SDL_PIXELFORMAT_ARGB8888 );
+        if( sourceSurface == NULL || loadedSurface == NULL || SDL_SoftStretchLinear( sourceSurface, NULL, loadedSurface, NULL ) < 0 )
+        {
+            SDL_FreeSurface( sourceSurface );
+            SDL_FreeSurface( loadedSurface );
+            errormsg = "Unable to resample image! SDL Error: %s\n";
+            errormsg.append(SDL_GetError());
+            throw std::runtime_error(errormsg.c_str());
+        }
+        SDL_FreeSurface( sourceSurface );
+    }
+    else
+    {
+        //Color key image
+        SDL_SetColorKey( loadedSurface, SDL_TRUE, SDL_MapRGB( loadedSurface->format, 0, 0xFF, 0xFF ) );
+    }
+    
+    return loadedSurface;
+}
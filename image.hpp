@@ -0,0 +1,26 @@
+//
+//  image.hpp
+//  Game
+//
+//  Image decoding shared by the texture cache, the asset loader and the bundle packer.
+//
+
+#ifndef image_h
+#define image_h
+
+#include <SDL2/SDL.h>
+#include <string>
+
+//Asset files besides the sprites (see SPRITES)
+const char *const BACKGROUND_PATH = "background.bmp";
+const char *const FONT_PATH = "hand.ttf";
+
+//Name of an image asset at a size: the path, followed by "@WxH" when it is resampled (0 = original size)
+std::string GetAssetKey( const std::string &path, int width = 0, int height = 0 );
+
+//Loads an image and prepares its pixels for a texture: resampled to the size into an opaque
+//image, or colour keyed (cyan is transparent) at its original size.
+//Touches no renderer state so it can run on any thread, throws if the image cannot be loaded.
+SDL_Surface* DecodeImage( const std::string &path, int width = 0, int height = 0 );
+
+#endif /* image_h */
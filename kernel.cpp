@@ -0,0 +1,267 @@
+//
+//  kernel.cpp
+//  Game
+//
+
+#include "kernel.hpp"
+#include "simulation.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//Steps parachutists [begin, end) - also used for the tail the SIMD loop does not cover
+static void StepRange( const ParachutistArrays &arrays, const BoatFloor &floor, unsigned int begin, unsigned int end )
+{
+    for( unsigned int i = begin; i < end; ++i )
+    {
+        int vel = arrays.mVel[i];
+        
+        //Move the parachutist down and to the left
+        int posY = arrays.mPosY[i] + vel;
+        int posX = arrays.mPosX[i] - vel / 4;
+        arrays.mPosY[i] = posY;
+        arrays.mPosX[i] = posX;
+        
+        int feet = posY + arrays.mHeight[i]; // parachutist's feet Y offset
+        int flags = 0;
+        
+        //check if Parachutist passed the boat floor on this tick
+        if( feet > floor.mFloorY && feet <= floor.mFloorY + vel )
+        {
+            flags |= PARACHUTIST_PASSED;
+        }
+        
+        //check if Parachutist passed the bottom of the screen
+        if( posY - arrays.mHeight[i] > SCREEN_HEIGHT )
+        {
+            flags |= PARACHUTIST_OUT;
+        }
+        //check if the parachutist legs reached the boat floor
+        else if( feet <= floor.mFloorY && feet + vel > floor.mFloorY &&
+                 floor.mLeft - posX <= arrays.mLegRight[i] && floor.mRight - posX >= arrays.mLegLeft[i] )
+        {
+            flags |= PARACHUTIST_CAUGHT;
+        }
+        arrays.mFlags[i] = flags;
+    }
+}
+
+//Moves parachutists [begin, end) and flags the ones that passed the bottom of the screen
+static void MoveRange( const ParachutistArrays &arrays, unsigned int begin, unsigned int end )
+{
+    for( unsigned int i = begin; i < end; ++i )
+    {
+        int vel = arrays.mVel[i];
+        
+        //Move the parachutist down and to the left
+        arrays.mPosY[i] += vel;
+        arrays.mPosX[i] -= vel / 4;
+        arrays.mFlags[i] = ( arrays.mPosY[i] - arrays.mHeight[i] > SCREEN_HEIGHT ) ? PARACHUTIST_OUT : 0;
+    }
+}
+
+void StepParachutistsScalar( const ParachutistArrays &arrays, const BoatFloor &floor )
+{
+    StepRange( arrays, floor, 0, arrays.mCount );
+}
+
+void MoveParachutistsScalar( const ParachutistArrays &arrays )
+{
+    MoveRange( arrays, 0, arrays.mCount );
+}
+
+void TestParachutists( const ParachutistArrays &arrays, const BoatFloor &floor, const unsigned int *indices, unsigned int count )
+{
+    for( unsigned int n = 0; n < count; ++n )
+    {
+        unsigned int i = indices[n];
+        int vel = arrays.mVel[i];
+        int posX = arrays.mPosX[i];
+        int feet = arrays.mPosY[i] + arrays.mHeight[i]; // parachutist's feet Y offset
+        
+        //check if Parachutist passed the boat floor on this tick
+        if( feet > floor.mFloorY && feet <= floor.mFloorY + vel )
+        {
+            arrays.mFlags[i] |= PARACHUTIST_PASSED;
+        }
+        
+        //check if the parachutist legs reached the boat floor
+        if( !( arrays.mFlags[i] & PARACHUTIST_OUT ) && feet <= floor.mFloorY && feet + vel > floor.mFloorY &&
+            floor.mLeft - posX <= arrays.mLegRight[i] && floor.mRight - posX >= arrays.mLegLeft[i] )
+        {
+            arrays.mFlags[i] |= PARACHUTIST_CAUGHT;
+        }
+    }
+}
+
+#if defined(__AVX2__)
+
+void StepParachutistsSimd( const ParachutistArrays &arrays, const BoatFloor &floor )
+{
+    const __m256i floorY = _mm256_set1_epi32( floor.mFloorY );
+    const __m256i left = _mm256_set1_epi32( floor.mLeft );
+    const __m256i right = _mm256_set1_epi32( floor.mRight );
+    const __m256i bottom = _mm256_set1_epi32( SCREEN_HEIGHT );
+    const __m256i three = _mm256_set1_epi32( 3 );
+    const __m256i passedBit = _mm256_set1_epi32( PARACHUTIST_PASSED );
+    const __m256i outBit = _mm256_set1_epi32( PARACHUTIST_OUT );
+    const __m256i caughtBit = _mm256_set1_epi32( PARACHUTIST_CAUGHT );
+    
+    unsigned int i = 0;
+    for( ; i + 8 <= arrays.mCount; i += 8 )
+    {
+        __m256i vel = _mm256_loadu_si256( (const __m256i *)( arrays.mVel + i ) );
+        __m256i height = _mm256_loadu_si256( (const __m256i *)( arrays.mHeight + i ) );
+        
+        //vel / 4 rounding towards zero like the integer division
+        __m256i drift = _mm256_srai_epi32( _mm256_add_epi32( vel, _mm256_and_si256( _mm256_srai_epi32( vel, 31 ), three ) ), 2 );
+        __m256i posY = _mm256_add_epi32( _mm256_loadu_si256( (const __m256i *)( arrays.mPosY + i ) ), vel );
+        __m256i posX = _mm256_sub_epi32( _mm256_loadu_si256( (const __m256i *)( arrays.mPosX + i ) ), drift );
+        _mm256_storeu_si256( (__m256i *)( arrays.mPosY + i ), posY );
+        _mm256_storeu_si256( (__m256i *)( arrays.mPosX + i ), posX );
+        
+        __m256i feet = _mm256_add_epi32( posY, height );
+        __m256i belowFloor = _mm256_cmpgt_epi32( feet, floorY );
+        __m256i passed = _mm256_andnot_si256( _mm256_cmpgt_epi32( feet, _mm256_add_epi32( floorY, vel ) ), belowFloor );
+        __m256i out = _mm256_cmpgt_epi32( _mm256_sub_epi32( posY, height ), bottom );
+        
+        __m256i legLeft = _mm256_loadu_si256( (const __m256i *)( arrays.mLegLeft + i ) );
+        __m256i legRight = _mm256_loadu_si256( (const __m256i *)( arrays.mLegRight + i ) );
+        __m256i reaches = _mm256_andnot_si256( belowFloor, _mm256_cmpgt_epi32( _mm256_add_epi32( feet, vel ), floorY ) );
+        __m256i missLeft = _mm256_cmpgt_epi32( _mm256_sub_epi32( left, posX ), legRight );
+        __m256i missRight = _mm256_cmpgt_epi32( legLeft, _mm256_sub_epi32( right, posX ) );
+        __m256i caught = _mm256_andnot_si256( _mm256_or_si256( _mm256_or_si256( missLeft, missRight ), out ), reaches );
+        
+        __m256i flags = _mm256_or_si256( _mm256_and_si256( passed, passedBit ),
+                        _mm256_or_si256( _mm256_and_si256( out, outBit ), _mm256_and_si256( caught, caughtBit ) ) );
+        _mm256_storeu_si256( (__m256i *)( arrays.mFlags + i ), flags );
+    }
+    
+    StepRange( arrays, floor, i, arrays.mCount );
+}
+
+void MoveParachutistsSimd( const ParachutistArrays &arrays )
+{
+    const __m256i bottom = _mm256_set1_epi32( SCREEN_HEIGHT );
+    const __m256i three = _mm256_set1_epi32( 3 );
+    const __m256i outBit = _mm256_set1_epi32( PARACHUTIST_OUT );
+    
+    unsigned int i = 0;
+    for( ; i + 8 <= arrays.mCount; i += 8 )
+    {
+        __m256i vel = _mm256_loadu_si256( (const __m256i *)( arrays.mVel + i ) );
+        __m256i height = _mm256_loadu_si256( (const __m256i *)( arrays.mHeight + i ) );
+        __m256i drift = _mm256_srai_epi32( _mm256_add_epi32( vel, _mm256_and_si256( _mm256_srai_epi32( vel, 31 ), three ) ), 2 );
+        __m256i posY = _mm256_add_epi32( _mm256_loadu_si256( (const __m256i *)( arrays.mPosY + i ) ), vel );
+        __m256i posX = _mm256_sub_epi32( _mm256_loadu_si256( (const __m256i *)( arrays.mPosX + i ) ), drift );
+        _mm256_storeu_si256( (__m256i *)( arrays.mPosY + i ), posY );
+        _mm256_storeu_si256( (__m256i *)( arrays.mPosX + i ), posX );
+        __m256i out = _mm256_cmpgt_epi32( _mm256_sub_epi32( posY, height ), bottom );
+        _mm256_storeu_si256( (__m256i *)( arrays.mFlags + i ), _mm256_and_si256( out, outBit ) );
+    }
+    
+    MoveRange( arrays, i, arrays.mCount );
+}
+
+const char *GetSimdKernelName()
+{
+    return("AVX2");
+}
+
+#elif defined(__SSE2__)
+
+void StepParachutistsSimd( const ParachutistArrays &arrays, const BoatFloor &floor )
+{
+    const __m128i floorY = _mm_set1_epi32( floor.mFloorY );
+    const __m128i left = _mm_set1_epi32( floor.mLeft );
+    const __m128i right = _mm_set1_epi32( floor.mRight );
+    const __m128i bottom = _mm_set1_epi32( SCREEN_HEIGHT );
+    const __m128i three = _mm_set1_epi32( 3 );
+    const __m128i passedBit = _mm_set1_epi32( PARACHUTIST_PASSED );
+    const __m128i outBit = _mm_set1_epi32( PARACHUTIST_OUT );
+    const __m128i caughtBit = _mm_set1_epi32( PARACHUTIST_CAUGHT );
+    
+    unsigned int i = 0;
+    for( ; i + 4 <= arrays.mCount; i += 4 )
+    {
+        __m128i vel = _mm_loadu_si128( (const __m128i *)( arrays.mVel + i ) );
+        __m128i height = _mm_loadu_si128( (const __m128i *)( arrays.mHeight + i ) );
+        
+        //vel / 4 rounding towards zero like the integer division
+        __m128i drift = _mm_srai_epi32( _mm_add_epi32( vel, _mm_and_si128( _mm_srai_epi32( vel, 31 ), three ) ), 2 );
+        __m128i posY = _mm_add_epi32( _mm_loadu_si128( (const __m128i *)( arrays.mPosY + i ) ), vel );
+        __m128i posX = _mm_sub_epi32( _mm_loadu_si128( (const __m128i *)( arrays.mPosX + i ) ), drift );
+        _mm_storeu_si128( (__m128i *)( arrays.mPosY + i ), posY );
+        _mm_storeu_si128( (__m128i *)( arrays.mPosX + i ), posX );
+        
+        __m128i feet = _mm_add_epi32( posY, height );
+        __m128i belowFloor = _mm_cmpgt_epi32( feet, floorY );
+        __m128i passed = _mm_andnot_si128( _mm_cmpgt_epi32( feet, _mm_add_epi32( floorY, vel ) ), belowFloor );
+        __m128i out = _mm_cmpgt_epi32( _mm_sub_epi32( posY, height ), bottom );
+        
+        __m128i legLeft = _mm_loadu_si128( (const __m128i *)( arrays.mLegLeft + i ) );
+        __m128i legRight = _mm_loadu_si128( (const __m128i *)( arrays.mLegRight + i ) );
+        __m128i reaches = _mm_andnot_si128( belowFloor, _mm_cmpgt_epi32( _mm_add_epi32( feet, vel ), floorY ) );
+        __m128i missLeft = _mm_cmpgt_epi32( _mm_sub_epi32( left, posX ), legRight );
+        __m128i missRight = _mm_cmpgt_epi32( legLeft, _mm_sub_epi32( right, posX ) );
+        __m128i caught = _mm_andnot_si128( _mm_or_si128( _mm_or_si128( missLeft, missRight ), out ), reaches );
+        
+        __m128i flags = _mm_or_si128( _mm_and_si128( passed, passedBit ),
+                        _mm_or_si128( _mm_and_si128( out, outBit ), _mm_and_si128( caught, caughtBit ) ) );
+        _mm_storeu_si128( (__m128i *)( arrays.mFlags + i ), flags );
+    }
+    
+    StepRange( arrays, floor, i, arrays.mCount );
+}
+
+void MoveParachutistsSimd( const ParachutistArrays &arrays )
+{
+    const __m128i bottom = _mm_set1_epi32( SCREEN_HEIGHT );
+    const __m128i three = _mm_set1_epi32( 3 );
+    const __m128i outBit = _mm_set1_epi32( PARACHUTIST_OUT );
+    
+    unsigned int i = 0;
+    for( ; i + 4 <= arrays.mCount; i += 4 )
+    {
+        __m128i vel = _mm_loadu_si128( (const __m128i *)( arrays.mVel + i ) );
+        __m128i height = _mm_loadu_si128( (const __m128i *)( arrays.mHeight + i ) );
+        __m128i drift = _mm_srai_epi32( _mm_add_epi32( vel, _mm_and_si128( _mm_srai_epi32( vel, 31 ), three ) ), 2 );
+        __m128i posY = _mm_add_epi32( _mm_loadu_si128( (const __m128i *)( arrays.mPosY + i ) ), vel );
+        __m128i posX = _mm_sub_epi32( _mm_loadu_si128( (const __m128i *)( arrays.mPosX + i ) ), drift );
+        _mm_storeu_si128( (__m128i *)( arrays.mPosY + i ), posY );
+        _mm_storeu_si128( (__m128i *)( arrays.mPosX + i ), posX );
+        __m128i out = _mm_cmpgt_epi32( _mm_sub_epi32( posY, height ), bottom );
+        _mm_storeu_si128( (__m128i *)( arrays.mFlags + i ), _mm_and_si128( out, outBit ) );
+    }
+    
+    MoveRange( arrays, i, arrays.mCount );
+}
+
+const char *GetSimdKernelName()
+{
+    return("SSE2");
+}
+
+#else
+
+void StepParachutistsSimd( const ParachutistArrays &arrays, const BoatFloor &floor )
+{
+    //No SIMD instructions available - use the scalar kernel
+    StepRange( arrays, floor, 0, arrays.mCount );
+}
+
+void MoveParachutistsSimd( const ParachutistArrays &arrays )
+{
+    //No SIMD instructions available - use the scalar kernel
+    MoveRange( arrays, 0, arrays.mCount );
+}
+
+const char *GetSimdKernelName()
+{
+    return("scalar");
+}
+
+#endif
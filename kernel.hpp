@@ -0,0 +1,58 @@
+//
+//  kernel.hpp
+//  Game
+//
+//  Batch step of all parachutists: move, "passed the boat floor" check and boat floor hit test.
+//  The SIMD kernel (SSE2/AVX2) gives exactly the same results as the scalar one.
+//
+
+#ifndef kernel_h
+#define kernel_h
+
+//Flags set by the kernel for each parachutist
+enum ParachutistFlag
+{
+    PARACHUTIST_PASSED = 1, //feet passed the boat floor on this tick (a life is lost)
+    PARACHUTIST_OUT = 2, //passed the bottom of the screen
+    PARACHUTIST_CAUGHT = 4 //landed on the boat floor
+};
+
+//Structure of arrays the kernel works on (one entry per parachutist)
+struct ParachutistArrays
+{
+    int *mPosX; //X offsets
+    int *mPosY; //Y offsets
+    const int *mVel; //velocities
+    const int *mHeight; //heights
+    const int *mLegLeft; //X offset of the left leg (ceil of 37.5% of the width)
+    const int *mLegRight; //X offset of the right leg (floor of 62.5% of the width)
+    int *mFlags; //ParachutistFlag bits written by the kernel
+    unsigned int mCount; //number of parachutists
+};
+
+//Boat floor the parachutists are tested against, as integers computed once per tick
+struct BoatFloor
+{
+    int mFloorY; //floor of the boat floor Y offset (boat Y + 90% of its height)
+    int mLeft; //boat left X offset
+    int mRight; //boat right X offset
+};
+
+//Moves the parachutists one tick and sets their flags - plain C++
+void StepParachutistsScalar( const ParachutistArrays &arrays, const BoatFloor &floor );
+
+//Same as StepParachutistsScalar using the widest SIMD instructions the build allows
+void StepParachutistsSimd( const ParachutistArrays &arrays, const BoatFloor &floor );
+
+//Broad phase variant: moves the parachutists and sets only the PARACHUTIST_OUT flag
+void MoveParachutistsScalar( const ParachutistArrays &arrays );
+void MoveParachutistsSimd( const ParachutistArrays &arrays );
+
+//Broad phase variant: boat floor tests (PASSED / CAUGHT) for the listed parachutists only,
+//after they were moved - together with MoveParachutists* it gives the same flags as StepParachutists*
+void TestParachutists( const ParachutistArrays &arrays, const BoatFloor &floor, const unsigned int *indices, unsigned int count );
+
+//Name of the instruction set used by StepParachutistsSimd
+const char *GetSimdKernelName();
+
+#endif /* kernel_h */
@@ -0,0 +1,144 @@
+//
+//  latency.cpp
+//  Game
+//
+
+#include <string.h>
+#include <algorithm> // use of min and max
+
+#include "latency.hpp"
+
+static unsigned long ToMicroseconds( std::chrono::steady_clock::duration time )
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>( time ).count();
+}
+
+InputLatency::InputLatency(): mAppliedCount(0), mHistogram(LATENCY_BUCKETS, 0), mCount(0), mMaxUs(0)
+{
+    memset( mStageTotalUs, 0, sizeof(mStageTotalUs) );
+    mPending.reserve( 64 );
+}
+
+void InputLatency::KeyEvent( unsigned int ageMs )
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    PendingEvent event;
+    event.mStageStart[LATENCY_QUEUE] = now - std::chrono::milliseconds( ageMs );
+    event.mStageStart[LATENCY_TICK] = now;
+    event.mStageStart[LATENCY_PRESENT] = now;
+    mPending.push_back( event );
+}
+
+void InputLatency::Applied()
+{
+    //Called every tick - only look at the clock when an event waits for it
+    if( mAppliedCount == mPending.size() )
+    {
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for( size_t i = mAppliedCount; i < mPending.size(); ++i )
+    {
+        mPending[i].mStageStart[LATENCY_PRESENT] = now;
+    }
+    mAppliedCount = mPending.size();
+}
+
+void InputLatency::Presented()
+{
+    if( mAppliedCount == 0 )
+    {
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for( size_t i = 0; i < mAppliedCount; ++i )
+    {
+        const PendingEvent &event = mPending[i];
+        unsigned long latency = ToMicroseconds( now - event.mStageStart[LATENCY_QUEUE] );
+        ++mHistogram[ std::min( latency / LATENCY_BUCKET_US, (unsigned long)LATENCY_BUCKETS - 1 ) ];
+        mMaxUs = std::max( mMaxUs, latency );
+        for( int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage )
+        {
+            std::chrono::steady_clock::time_point end = stage + 1 < LATENCY_STAGE_COUNT ? event.mStageStart[stage + 1] : now;
+            mStageTotalUs[stage] += ToMicroseconds( end - event.mStageStart[stage] );
+        }
+        ++mCount;
+    }
+    
+    //Keep the events that are still waiting for a tick
+    mPending.erase( mPending.begin(), mPending.begin() + mAppliedCount );
+    mAppliedCount = 0;
+}
+
+unsigned long InputLatency::GetCount() const
+{
+    return(mCount);
+}
+
+double InputLatency::GetPercentile( double percentile ) const
+{
+    if( mCount == 0 )
+    {
+        return 0.0;
+    }
+    unsigned long rank = (unsigned long)( percentile / 100.0 * ( mCount - 1 ) + 0.5 );
+    unsigned long seen = 0;
+    for( unsigned int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket )
+    {
+        seen += mHistogram[bucket];
+        if( seen > rank )
+        {
+            return bucket + 1 < LATENCY_BUCKETS ? std::min( ( bucket + 1 ) * LATENCY_BUCKET_US / 1000.0, GetMax() ) : GetMax();
+        }
+    }
+    return GetMax();
+}
+
+double InputLatency::GetMax() const
+{
+    return mMaxUs / 1000.0;
+}
+
+double InputLatency::GetStageAverage( LatencyStage stage ) const
+{
+    return mCount ? mStageTotalUs[stage] / mCount / 1000.0 : 0.0;
+}
+
+void InputLatency::Print( FILE *file ) const
+{
+    if( mCount == 0 )
+    {
+        return;
+    }
+    
+    fprintf( file, "Input latency: %lu key events, p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n", mCount,
+             GetPercentile( 50.0 ), GetPercentile( 90.0 ), GetPercentile( 99.0 ), GetMax() );
+    fprintf( file, "Input latency stages: queue %.2f ms, wait for tick %.2f ms, tick to present %.2f ms (average)\n",
+             GetStageAverage( LATENCY_QUEUE ), GetStageAverage( LATENCY_TICK ), GetStageAverage( LATENCY_PRESENT ) );
+    
+    //One row per bucket from the first to the last that has events
+    unsigned int first = 0, last = 0;
+    unsigned long largest = 0;
+    for( unsigned int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket )
+    {
+        if( mHistogram[bucket] > 0 )
+        {
+            if( largest == 0 )
+            {
+                first = bucket;
+            }
+            last = bucket;
+            largest = std::max( largest, mHistogram[bucket] );
+        }
+    }
+    for( unsigned int bucket = first; bucket <= last; ++bucket )
+    {
+        int width = (int)( 40 * mHistogram[bucket] / largest );
+        fprintf( file, "  %3u%s ms %6lu ", bucket * LATENCY_BUCKET_US / 1000, bucket + 1 < LATENCY_BUCKETS ? "" : "+", mHistogram[bucket] );
+        for( int i = 0; i < width; ++i )
+        {
+            fputc( '#', file );
+        }
+        fputc( '\n', file );
+    }
+}
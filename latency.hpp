@@ -0,0 +1,72 @@
+//
+//  latency.hpp
+//  Game
+//
+//  Input latency: every key event is followed from the moment it happened, through the tick that
+//  applies it, to the present of the first frame that shows the tick. The latencies are kept in a
+//  histogram of 1 ms buckets; the stages tell where the time went.
+//
+
+#ifndef latency_h
+#define latency_h
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+//Width of a histogram bucket in microseconds
+const unsigned int LATENCY_BUCKET_US = 1000;
+//Histogram buckets (the last one holds every longer latency)
+const unsigned int LATENCY_BUCKETS = 100;
+
+//Where the latency of a key event goes
+enum LatencyStage
+{
+    LATENCY_QUEUE, //from the key event to reading it from the event queue
+    LATENCY_TICK, //from reading the event to the tick that applies it
+    LATENCY_PRESENT, //from the tick to the present of its frame
+    LATENCY_STAGE_COUNT
+};
+
+class InputLatency
+{
+public:
+    //Constructor: Initializes the variables
+    InputLatency();
+    
+    //A key event read from the event queue ageMs milliseconds after it happened
+    void KeyEvent( unsigned int ageMs );
+    //A tick applied the key events read so far
+    void Applied();
+    //A frame was presented - the applied key events are on the screen
+    void Presented();
+    
+    //Statistics (in milliseconds)
+    unsigned long GetCount() const; //key events that reached the screen
+    double GetPercentile( double percentile ) const; //upper bound of the bucket holding the percentile
+    double GetMax() const;
+    double GetStageAverage( LatencyStage stage ) const;
+    
+    //Prints the statistics and the histogram (nothing when no key event reached the screen)
+    void Print( FILE *file ) const;
+    
+private:
+    
+    InputLatency( const InputLatency &other_); //disable copy constructor
+    
+    //A key event on its way to the screen
+    struct PendingEvent
+    {
+        std::chrono::steady_clock::time_point mStageStart[LATENCY_STAGE_COUNT];
+    };
+    
+    std::vector<PendingEvent> mPending; //events by arrival, the first mAppliedCount were applied by a tick
+    size_t mAppliedCount;
+    
+    std::vector<unsigned long> mHistogram; //latencies by LATENCY_BUCKET_US bucket
+    unsigned long mCount;
+    unsigned long mMaxUs;
+    double mStageTotalUs[LATENCY_STAGE_COUNT];
+};
+
+#endif /* latency_h */
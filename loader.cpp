@@ -0,0 +1,137 @@
+//
+//  loader.cpp
+//  Game
+//
+
+#include <stdexcept>
+#include <chrono>
+
+#include "loader.hpp"
+#include "game.hpp"
+#include "image.hpp"
+
+AssetLoader::AssetLoader(): mNextJob(0), mUploaded(0)
+{}
+
+AssetLoader::~AssetLoader()
+{
+    //Let the workers finish the jobs they took, and stop the others from taking more
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mNextJob = mJobs.size();
+    }
+    for( size_t i = 0; i < mThreads.size(); ++i )
+    {
+        mThreads[i].join();
+    }
+    
+    for( size_t i = 0; i < mJobs.size(); ++i )
+    {
+        SDL_FreeSurface( mJobs[i].mSurface );
+    }
+}
+
+void AssetLoader::Request( const std::string &path, int width, int height )
+{
+    Job job;
+    job.mPath = path;
+    job.mWidth = width;
+    job.mHeight = height;
+    job.mSurface = NULL;
+    mJobs.push_back( job );
+}
+
+void AssetLoader::Start( unsigned int maxThreads )
+{
+    unsigned int threads = maxThreads > 0 ? maxThreads : std::thread::hardware_concurrency();
+    if( threads == 0 )
+    {
+        threads = 1;
+    }
+    if( threads > mJobs.size() )
+    {
+        threads = (unsigned int)mJobs.size();
+    }
+    
+    for( unsigned int i = 0; i < threads; ++i )
+    {
+        mThreads.push_back( std::thread( &AssetLoader::Work, this ) );
+    }
+}
+
+void AssetLoader::Work()
+{
+    for( ;; )
+    {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            if( mNextJob >= mJobs.size() )
+            {
+                return;
+            }
+            index = mNextJob++;
+        }
+        
+        //Decode without holding the lock - this is the slow part
+        Job &job = mJobs[index];
+        try
+        {
+            job.mSurface = DecodeImage( job.mPath, job.mWidth, job.mHeight );
+        }
+        catch( const std::exception &e )
+        {
+            job.mError = e.what();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mReady.push_back( index );
+        }
+        mDecoded.notify_one();
+    }
+}
+
+unsigned int AssetLoader::Upload( TextureCache &cache, unsigned int timeoutMs )
+{
+    //Take the decoded jobs
+    std::vector<size_t> ready;
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        if( mReady.empty() && mUploaded < mJobs.size() )
+        {
+            mDecoded.wait_for( lock, std::chrono::milliseconds( timeoutMs ) );
+        }
+        ready.swap( mReady );
+    }
+    
+    //Create their textures on this thread
+    for( size_t i = 0; i < ready.size(); ++i )
+    {
+        Job &job = mJobs[ready[i]];
+        if( job.mSurface == NULL )
+        {
+            throw std::runtime_error(job.mError.c_str());
+        }
+        SDL_Surface *surface = job.mSurface;
+        job.mSurface = NULL; // the cache owns it now
+        cache.Add( job.mPath, job.mWidth, job.mHeight, surface );
+        ++mUploaded;
+    }
+    return (unsigned int)ready.size();
+}
+
+bool AssetLoader::IsDone() const
+{
+    return mUploaded == mJobs.size();
+}
+
+unsigned int AssetLoader::GetRequestCount() const
+{
+    return (unsigned int)mJobs.size();
+}
+
+unsigned int AssetLoader::GetUploadedCount() const
+{
+    return(mUploaded);
+}
@@ -0,0 +1,70 @@
+//
+//  loader.hpp
+//  Game
+//
+//  Asynchronous image loading: worker threads decode the images to surfaces while the
+//  render thread keeps drawing, the render thread then creates the textures (SDL renderers
+//  may only be used from the thread that created them).
+//
+
+#ifndef loader_h
+#define loader_h
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class TextureCache;
+
+class AssetLoader
+{
+public:
+    //Constructor: Initializes the variables
+    AssetLoader();
+    //Destructor: waits for the workers and frees the surfaces that were not uploaded
+    ~AssetLoader();
+    
+    //Adds an image to decode (with a size it is resampled, see DecodeImage)
+    void Request( const std::string &path, int width = 0, int height = 0 );
+    //Starts decoding the requested images on up to maxThreads worker threads (0 = one per core)
+    void Start( unsigned int maxThreads = 0 );
+    
+    //Waits up to timeoutMs for decoded images and adds them to the texture cache (render thread only),
+    //returns how many were added. Throws the error of an image that could not be decoded.
+    unsigned int Upload( TextureCache &cache, unsigned int timeoutMs );
+    
+    //Progress
+    bool IsDone() const; //every requested image was added to the cache
+    unsigned int GetRequestCount() const;
+    unsigned int GetUploadedCount() const;
+    
+private:
+    
+    AssetLoader( const AssetLoader &other_); //disable copy constructor
+    
+    //An image to decode
+    struct Job
+    {
+        std::string mPath; //image file
+        int mWidth, mHeight; //resampled size (0 = original size)
+        SDL_Surface *mSurface; //decoded image (owned until uploaded)
+        std::string mError; //why the image could not be decoded
+    };
+    
+    //Worker thread: decodes jobs until none is left
+    void Work();
+    
+    std::vector<Job> mJobs; //requested images
+    std::vector<std::thread> mThreads; //decoding threads
+    
+    std::mutex mMutex; //guards the members below
+    std::condition_variable mDecoded; //signalled when a job was decoded
+    size_t mNextJob; //first job no worker took yet
+    std::vector<size_t> mReady; //decoded jobs waiting for Upload
+    unsigned int mUploaded; //jobs added to the cache
+};
+
+#endif /* loader_h */
@@ -6,15 +6,234 @@
 //  Copyright © 2016 Itamar Jobani. All rights reserved.
 //
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <exception>
+
+#include "headless.hpp"
+#include "batch.hpp"
+#include "controller.hpp"
+#include "telemetry.hpp"
+#include "scenario.hpp"
+#include "capture.hpp"
+//Headless builds (-DGAME_HEADLESS) do not depend on SDL at all
+#ifndef GAME_HEADLESS
 #include "game.hpp"
+#endif
 
 int main( int argc, char* args[] )
 {
+    GameConfig config;
+    bool maxParachutistsGiven = false; //--max-parachutists wins over the pool a scenario asks for
+    
+    //Read the command line options
+    for( int i = 1; i < argc; ++i )
+    {
+        if( strcmp( args[i], "--tick-rate" ) == 0 && i + 1 < argc )
+        {
+            config.mTickRate = atoi( args[++i] ); // simulation ticks per second
+        }
+        else if( strcmp( args[i], "--catch-up" ) == 0 && i + 1 < argc )
+        {
+            config.mMaxCatchUpTicks = atoi( args[++i] ); // maximum ticks per rendered frame
+        }
+        else if( strcmp( args[i], "--uncapped" ) == 0 )
+        {
+            config.mVsync = false; // render as fast as possible
+        }
+        else if( strcmp( args[i], "--low-latency" ) == 0 )
+        {
+            config.mLowLatency = true; // read the input as late as possible and keep no frame queued
+        }
+        else if( strcmp( args[i], "--sim-thread" ) == 0 )
+        {
+            config.mSimulationThread = true; // simulate on a thread of its own while the main thread renders
+        }
+        else if( strcmp( args[i], "--no-clear" ) == 0 )
+        {
+            config.mClearFrame = false; // the background covers the frame, skip clearing it
+        }
+        else if( strcmp( args[i], "--dirty-rects" ) == 0 )
+        {
+            config.mDirtyRects = true; // redraw only what changed since the last frame
+        }
+        else if( strcmp( args[i], "--headless" ) == 0 )
+        {
+            config.mHeadless = true; // simulation only, no window
+        }
+        else if( strcmp( args[i], "--ticks" ) == 0 && i + 1 < argc )
+        {
+            config.mHeadlessTicks = strtoul( args[++i], NULL, 10 ); // ticks simulated by a headless run
+        }
+        else if( strcmp( args[i], "--max-parachutists" ) == 0 && i + 1 < argc )
+        {
+            config.mMaxParachutists = (unsigned int)strtoul( args[++i], NULL, 10 ); // parachutist pool capacity
+            maxParachutistsGiven = true;
+        }
+        else if( strcmp( args[i], "--broad-phase" ) == 0 )
+        {
+            config.mBroadPhase = true; // test only the parachutists the grid finds near the boat floor (slower, see README)
+        }
+        else if( strcmp( args[i], "--profile" ) == 0 )
+        {
+            config.mProfile = true; // time the frame phases, written as CSV at exit
+        }
+        else if( strcmp( args[i], "--profile-overlay" ) == 0 )
+        {
+            config.mProfile = config.mProfileOverlay = true; // also show the frame times on screen
+        }
+        else if( strcmp( args[i], "--profile-csv" ) == 0 && i + 1 < argc )
+        {
+            config.mProfile = true;
+            config.mProfileCsv = args[++i]; // file the frame profile is written to
+        }
+        else if( strcmp( args[i], "--seed" ) == 0 && i + 1 < argc )
+        {
+            config.mSeed = strtoull( args[++i], NULL, 10 ); // seed of the random jump points
+        }
+        else if( strcmp( args[i], "--record" ) == 0 && i + 1 < argc )
+        {
+            config.mRecordPath = args[++i]; // record the key transitions to an input log
+        }
+        else if( strcmp( args[i], "--replay" ) == 0 && i + 1 < argc )
+        {
+            config.mReplayPath = args[++i]; // play an input log instead of the keyboard
+        }
+        else if( strcmp( args[i], "--bundle" ) == 0 && i + 1 < argc )
+        {
+            config.mBundlePath = args[++i]; // asset bundle made by the packer
+        }
+        else if( strcmp( args[i], "--controller" ) == 0 && i + 1 < argc )
+        {
+            // what drives the boat: keyboard, chase or intercept
+            if( !ParseBoatController( args[++i], &config.mController ) )
+            {
+                printf( "Unknown controller %s (keyboard, chase or intercept)\n", args[i] );
+                return 1;
+            }
+        }
+        else if( strcmp( args[i], "--telemetry" ) == 0 && i + 1 < argc )
+        {
+            config.mTelemetryTarget = args[++i]; // export live telemetry to a file or a unix:PATH socket
+        }
+        else if( strcmp( args[i], "--telemetry-format" ) == 0 && i + 1 < argc )
+        {
+            // format of the exported telemetry: json or binary
+            if( !ParseTelemetryFormat( args[++i], &config.mTelemetryFormat ) )
+            {
+                printf( "Unknown telemetry format %s (json or binary)\n", args[i] );
+                return 1;
+            }
+        }
+        else if( strcmp( args[i], "--scenario" ) == 0 && i + 1 < argc )
+        {
+            // what the game spawns: a built-in scenario or a scenario file
+            config.mScenarioName = args[++i];
+            if( !FindScenario( config.mScenarioName, &config.mScenario ) )
+            {
+                try
+                {
+                    config.mScenario = LoadScenarioFile( config.mScenarioName );
+                }
+                catch( const std::exception &e )
+                {
+                    printf( "%s (--list-scenarios shows the built-in scenarios)\n", e.what() );
+                    return 1;
+                }
+            }
+        }
+        else if( strcmp( args[i], "--list-scenarios" ) == 0 )
+        {
+            PrintScenarios();
+            return 0;
+        }
+        else if( strcmp( args[i], "--capture" ) == 0 && i + 1 < argc )
+        {
+            config.mCapturePath = args[++i]; // write the rendered frames to a video file (or numbered PPM files)
+        }
+        else if( strcmp( args[i], "--capture-format" ) == 0 && i + 1 < argc )
+        {
+            // format of the captured frames: y4m or ppm
+            if( !ParseCaptureFormat( args[++i], &config.mCaptureFormat ) )
+            {
+                printf( "Unknown capture format %s (y4m or ppm)\n", args[i] );
+                return 1;
+            }
+        }
+        else if( strcmp( args[i], "--render-bench" ) == 0 )
+        {
+            config.mRenderBench = true; // draw a fixed session offscreen with the software renderer
+        }
+        else if( strcmp( args[i], "--frames" ) == 0 && i + 1 < argc )
+        {
+            config.mRenderBenchFrames = strtoul( args[++i], NULL, 10 ); // frames of the render benchmark
+        }
+        else if( strcmp( args[i], "--golden" ) == 0 && i + 1 < argc )
+        {
+            config.mGoldenPath = args[++i]; // frame hashes the render benchmark must match
+        }
+        else if( strcmp( args[i], "--no-golden" ) == 0 )
+        {
+            config.mGoldenPath = NULL; // only time the render benchmark
+        }
+        else if( strcmp( args[i], "--update-golden" ) == 0 )
+        {
+            config.mUpdateGolden = true; // write the frame hashes instead of comparing them
+        }
+        else if( strcmp( args[i], "--batch" ) == 0 && i + 1 < argc )
+        {
+            config.mBatchGames = (unsigned int)strtoul( args[++i], NULL, 10 ); // play that many games on all cores, no window
+        }
+        else if( strcmp( args[i], "--threads" ) == 0 && i + 1 < argc )
+        {
+            config.mBatchThreads = (unsigned int)strtoul( args[++i], NULL, 10 ); // threads of a batch run
+        }
+        else if( strcmp( args[i], "--batch-max-ticks" ) == 0 && i + 1 < argc )
+        {
+            config.mBatchMaxTicks = strtoul( args[++i], NULL, 10 ); // longest game of a batch run
+        }
+    }
+    
+    //The pool the scenario needs, unless the command line set one
+    if( config.mScenario.mMaxParachutists > 0 && !maxParachutistsGiven )
+    {
+        config.mMaxParachutists = config.mScenario.mMaxParachutists;
+    }
+    
+#ifdef GAME_HEADLESS
+    config.mHeadless = true;
+#endif
+    
+    if( config.mBatchGames > 0 )
+    {
+        //Play independent games on every core
+        BatchRunner batchRunner( config );
+        batchRunner.Run();
+        return 0;
+    }
+    
+    if( config.mHeadless )
+    {
+        //Run the simulation as fast as possible without a window (a replay that does not match fails the run)
+        HeadlessGame headlessGame( config );
+        return headlessGame.Run() ? 0 : 1;
+    }
+    
+#ifndef GAME_HEADLESS
+    if( config.mRenderBench )
+    {
+        //Draw a fixed session offscreen and check the frames against the golden hashes
+        Game renderBenchGame( config );
+        return renderBenchGame.RunRenderBench() ? 0 : 1;
+    }
+    
     //Create a new game
-    Game parachutistGame;
+    Game parachutistGame( config );
     
     //Run game
     parachutistGame.Run();
+#endif
     
     return 0;
 }
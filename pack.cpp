@@ -0,0 +1,105 @@
+//
+//  pack.cpp
+//  Game
+//
+//  Asset packer: decodes the game assets once and writes them into an asset bundle (see bundle.hpp)
+//  so the game starts without decoding anything. Run it from the asset directory:
+//      game_pack [bundle path]
+//
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <vector>
+
+#include "config.hpp"
+#include "simulation.hpp"
+#include "bundle.hpp"
+#include "image.hpp"
+
+//Decodes an image the way the game does and adds its RGBA pixels (colour key turned into alpha)
+static void PackImage( BundleWriter &writer, const char *path, int width = 0, int height = 0 )
+{
+    std::string errormsg;
+    
+    SDL_Surface *decoded = DecodeImage( path, width, height );
+    SDL_Surface *rgba = SDL_ConvertSurfaceFormat( decoded, SDL_PIXELFORMAT_RGBA32, 0 );
+    SDL_FreeSurface( decoded );
+    if( rgba == NULL )
+    {
+        errormsg = "Unable to convert image! SDL Error: ";
+        errormsg.append(SDL_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    
+    writer.AddImage( GetAssetKey( path, width, height ), rgba->w, rgba->h, rgba->pitch, rgba->format->format, width > 0 && height > 0, rgba->pixels );
+    printf( "%s: %dx%d\n", GetAssetKey( path, width, height ).c_str(), rgba->w, rgba->h );
+    SDL_FreeSurface( rgba );
+}
+
+//Adds a file as is
+static void PackFile( BundleWriter &writer, const char *path )
+{
+    std::string errormsg;
+    
+    FILE *file = fopen( path, "rb" );
+    if( file == NULL )
+    {
+        errormsg = "Unable to open ";
+        errormsg.append(path);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[4096];
+    size_t read;
+    while( ( read = fread( buffer, 1, sizeof(buffer), file ) ) > 0 )
+    {
+        data.insert( data.end(), buffer, buffer + read );
+    }
+    fclose( file );
+    
+    writer.AddFile( path, data.empty() ? NULL : &data[0], data.size() );
+    printf( "%s: %lu bytes\n", path, (unsigned long)data.size() );
+}
+
+int main( int argc, char* args[] )
+{
+    const char *bundlePath = argc > 1 ? args[1] : DEFAULT_BUNDLE_PATH;
+    
+    if( SDL_Init( 0 ) < 0 || !( IMG_Init( IMG_INIT_PNG ) & IMG_INIT_PNG ) )
+    {
+        printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+        return 1;
+    }
+    
+    //The same assets at the same sizes the game asks its texture cache for
+    BundleWriter writer;
+    try
+    {
+        PackImage( writer, BACKGROUND_PATH, SCREEN_WIDTH, SCREEN_HEIGHT );
+        for( int i = 0; i < SPRITE_COUNT; ++i )
+        {
+            PackImage( writer, SPRITES[i].mPath );
+        }
+        PackFile( writer, FONT_PATH );
+    }
+    catch( const std::exception &e )
+    {
+        printf( "%s\n", e.what() );
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+    
+    IMG_Quit();
+    SDL_Quit();
+    
+    if( !writer.Write( bundlePath ) )
+    {
+        printf( "Could not write the bundle to %s\n", bundlePath );
+        return 1;
+    }
+    printf( "Bundle written to %s\n", bundlePath );
+    return 0;
+}
@@ -0,0 +1,162 @@
+//
+//  profiler.cpp
+//  Game
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm> // use of nth_element
+
+#include "profiler.hpp"
+
+//Names of the phases (CSV header)
+static const char *PHASE_NAMES[PHASE_COUNT] = { "events", "simulation", "text", "render", "capture", "present" };
+
+static unsigned int ToMicroseconds( std::chrono::steady_clock::duration time )
+{
+    return (unsigned int)std::chrono::duration_cast<std::chrono::microseconds>( time ).count();
+}
+
+FrameProfiler::FrameProfiler(bool enabled_): mEnabled(enabled_), mFrameIndex(0)
+{
+    memset( &mCurrent, 0, sizeof(mCurrent) );
+    if( mEnabled )
+    {
+        mFrames.resize( PROFILER_FRAMES );
+    }
+}
+
+void FrameProfiler::SetEnabled( bool enabled_ )
+{
+    mEnabled = enabled_;
+    if( mEnabled && mFrames.empty() )
+    {
+        mFrames.resize( PROFILER_FRAMES );
+    }
+}
+
+bool FrameProfiler::IsEnabled() const
+{
+    return(mEnabled);
+}
+
+void FrameProfiler::BeginFrame()
+{
+    if( !mEnabled )
+    {
+        return;
+    }
+    memset( &mCurrent, 0, sizeof(mCurrent) );
+    mFrameStart = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::EndFrame( unsigned int ticks, unsigned int entities )
+{
+    if( !mEnabled )
+    {
+        return;
+    }
+    mCurrent.mFrameTime = ToMicroseconds( std::chrono::steady_clock::now() - mFrameStart );
+    mCurrent.mTicks = ticks;
+    mCurrent.mEntities = entities;
+    mFrames[mFrameIndex % PROFILER_FRAMES] = mCurrent;
+    ++mFrameIndex;
+}
+
+void FrameProfiler::AddPhaseTime( ProfilePhase phase, std::chrono::steady_clock::duration time )
+{
+    mCurrent.mPhaseTime[phase] += ToMicroseconds( time );
+}
+
+unsigned int FrameProfiler::GetFrameCount() const
+{
+    return (unsigned int)std::min( mFrameIndex, (unsigned long)PROFILER_FRAMES );
+}
+
+double FrameProfiler::GetFramePercentile( double percentile ) const
+{
+    unsigned int count = GetFrameCount();
+    if( count == 0 )
+    {
+        return 0.0;
+    }
+    
+    mScratch.resize( count );
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        mScratch[i] = mFrames[i].mFrameTime;
+    }
+    unsigned int rank = (unsigned int)( percentile / 100.0 * ( count - 1 ) + 0.5 );
+    std::nth_element( mScratch.begin(), mScratch.begin() + rank, mScratch.end() );
+    return mScratch[rank] / 1000.0;
+}
+
+double FrameProfiler::GetPhaseAverage( ProfilePhase phase ) const
+{
+    unsigned int count = GetFrameCount();
+    if( count == 0 )
+    {
+        return 0.0;
+    }
+    
+    double total = 0.0;
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        total += mFrames[i].mPhaseTime[phase];
+    }
+    return total / count / 1000.0;
+}
+
+const FrameSample& FrameProfiler::GetLastFrame() const
+{
+    return mFrames.empty() || mFrameIndex == 0 ? mCurrent : mFrames[( mFrameIndex - 1 ) % PROFILER_FRAMES];
+}
+
+bool FrameProfiler::WriteCsv( const std::string &path ) const
+{
+    FILE *file = fopen( path.c_str(), "w" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    
+    fprintf( file, "frame,frame_us" );
+    for( int phase = 0; phase < PHASE_COUNT; ++phase )
+    {
+        fprintf( file, ",%s_us", PHASE_NAMES[phase] );
+    }
+    fprintf( file, ",ticks,entities\n" );
+    
+    //Oldest frame first
+    unsigned int count = GetFrameCount();
+    unsigned long first = mFrameIndex - count;
+    for( unsigned long frame = first; frame < mFrameIndex; ++frame )
+    {
+        const FrameSample &sample = mFrames[frame % PROFILER_FRAMES];
+        fprintf( file, "%lu,%u", frame, sample.mFrameTime );
+        for( int phase = 0; phase < PHASE_COUNT; ++phase )
+        {
+            fprintf( file, ",%u", sample.mPhaseTime[phase] );
+        }
+        fprintf( file, ",%u,%u\n", sample.mTicks, sample.mEntities );
+    }
+    
+    fclose( file );
+    return true;
+}
+
+ProfileScope::ProfileScope(FrameProfiler &mProfiler_, ProfilePhase mPhase_): mProfiler(mProfiler_), mPhase(mPhase_)
+{
+    if( mProfiler.IsEnabled() )
+    {
+        mStart = std::chrono::steady_clock::now();
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if( mProfiler.IsEnabled() )
+    {
+        mProfiler.AddPhaseTime( mPhase, std::chrono::steady_clock::now() - mStart );
+    }
+}
@@ -0,0 +1,91 @@
+//
+//  profiler.hpp
+//  Game
+//
+//  Frame profiler: scoped timers record how long each phase of a frame takes into a ring
+//  buffer of the last frames. When the profiler is off a scope costs one branch.
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <chrono>
+#include <vector>
+#include <string>
+
+//Phases of a frame
+enum ProfilePhase
+{
+    PHASE_EVENTS, //SDL_PollEvent loop
+    PHASE_SIMULATION, //simulation ticks
+    PHASE_TEXT, //HUD text update
+    PHASE_RENDER, //queueing and submitting the draws
+    PHASE_CAPTURE, //reading the frame back for the gameplay capture
+    PHASE_PRESENT, //SDL_RenderPresent
+    PHASE_COUNT
+};
+
+//Number of frames kept by the profiler
+const unsigned int PROFILER_FRAMES = 4096;
+
+//Timings of one frame
+struct FrameSample
+{
+    unsigned int mFrameTime; //whole frame in microseconds
+    unsigned int mPhaseTime[PHASE_COUNT]; //each phase in microseconds
+    unsigned int mTicks; //simulation ticks run in the frame
+    unsigned int mEntities; //parachutists alive at the end of the frame
+};
+
+class FrameProfiler
+{
+public:
+    //Constructor: a disabled profiler records nothing
+    FrameProfiler(bool enabled_ = false);
+    
+    //Turns recording on or off
+    void SetEnabled( bool enabled_ );
+    bool IsEnabled() const;
+    
+    //Starts and ends a frame
+    void BeginFrame();
+    void EndFrame( unsigned int ticks, unsigned int entities );
+    
+    //Adds time to a phase of the current frame
+    void AddPhaseTime( ProfilePhase phase, std::chrono::steady_clock::duration time );
+    
+    //Statistics over the recorded frames (in milliseconds)
+    unsigned int GetFrameCount() const; //frames in the ring buffer
+    double GetFramePercentile( double percentile ) const;
+    double GetPhaseAverage( ProfilePhase phase ) const;
+    const FrameSample &GetLastFrame() const;
+    
+    //Writes the recorded frames as CSV, returns false if the file could not be written
+    bool WriteCsv( const std::string &path ) const;
+    
+private:
+    
+    bool mEnabled;
+    std::chrono::steady_clock::time_point mFrameStart; //start of the current frame
+    FrameSample mCurrent; //frame being recorded
+    std::vector<FrameSample> mFrames; //ring buffer of the last frames
+    unsigned long mFrameIndex; //frames recorded since the start
+    mutable std::vector<unsigned int> mScratch; //frame times sorted for percentiles
+};
+
+//Adds the time from its construction to its destruction to a phase
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler &mProfiler_, ProfilePhase mPhase_);
+    ~ProfileScope();
+    
+private:
+    ProfileScope( const ProfileScope &other_); //disable copy constructor
+    
+    FrameProfiler &mProfiler;
+    ProfilePhase mPhase;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+#endif /* profiler_h */
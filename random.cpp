@@ -0,0 +1,54 @@
+//
+//  random.cpp
+//  Game
+//
+//  PCG32 (XSH-RR variant) by M.E. O'Neill, see pcg-random.org
+//
+
+#include "random.hpp"
+
+//LCG multiplier and default stream of PCG32
+const uint64_t PCG_MULTIPLIER = 6364136223846793005ULL;
+const uint64_t PCG_STREAM = 0xda3e39cb94b95bdbULL;
+
+Random::Random(uint64_t seed_): mState(0), mIncrement((PCG_STREAM << 1u) | 1u)
+{
+    Next();
+    mState += seed_;
+    Next();
+}
+
+uint32_t Random::Next()
+{
+    uint64_t oldState = mState;
+    mState = oldState * PCG_MULTIPLIER + mIncrement;
+    uint32_t xorShifted = (uint32_t)( ( ( oldState >> 18u ) ^ oldState ) >> 27u );
+    uint32_t rotation = (uint32_t)( oldState >> 59u );
+    return ( xorShifted >> rotation ) | ( xorShifted << ( ( -rotation ) & 31 ) );
+}
+
+uint32_t Random::NextBelow( uint32_t bound )
+{
+    //Reject the few values that would make the low numbers more likely
+    uint32_t threshold = -bound % bound;
+    for( ;; )
+    {
+        uint32_t value = Next();
+        if( value >= threshold )
+        {
+            return value % bound;
+        }
+    }
+}
+
+void Random::GetState( uint64_t *state_, uint64_t *increment_ ) const
+{
+    *state_ = mState;
+    *increment_ = mIncrement;
+}
+
+void Random::SetState( uint64_t state_, uint64_t increment_ )
+{
+    mState = state_;
+    mIncrement = increment_;
+}
@@ -0,0 +1,33 @@
+//
+//  random.hpp
+//  Game
+//
+//  Seeded pseudo random number generator (PCG32) - the same seed always gives the same game.
+//
+
+#ifndef random_h
+#define random_h
+
+#include <stdint.h>
+
+class Random
+{
+public:
+    //Constructor: starts the sequence of the seed
+    Random(uint64_t seed_);
+    
+    //Returns the next 32 random bits
+    uint32_t Next();
+    //Returns a number in [0, bound) without modulo bias
+    uint32_t NextBelow( uint32_t bound );
+    
+    //Generator state (for game snapshots) - SetState continues the sequence GetState was taken from
+    void GetState( uint64_t *state_, uint64_t *increment_ ) const;
+    void SetState( uint64_t state_, uint64_t increment_ );
+    
+private:
+    uint64_t mState; //generator state
+    uint64_t mIncrement; //stream of the generator (odd)
+};
+
+#endif /* random_h */
@@ -0,0 +1,359 @@
+//
+//  render.cpp
+//  Game
+//
+
+#include <math.h>
+#include <algorithm> // use of sort
+
+#include "render.hpp"
+#include "game.hpp"
+
+//Order of the queued draws: layer, then texture, then submission order
+static bool CommandLess( const RenderCommand &a, const RenderCommand &b )
+{
+    if( a.mLayer != b.mLayer )
+    {
+        return a.mLayer < b.mLayer;
+    }
+    if( a.mTexture != b.mTexture )
+    {
+        return a.mTexture < b.mTexture;
+    }
+    return a.mOrder < b.mOrder;
+}
+
+//FNV-1a over the vertices of a geometry draw (text is rebuilt in place, the vector stays the same)
+static uint32_t HashVertices( const std::vector<SDL_Vertex> &vertices )
+{
+    uint32_t hash = 2166136261u;
+    const unsigned char *bytes = vertices.empty() ? NULL : (const unsigned char *)&vertices[0];
+    for( size_t i = 0; i < vertices.size() * sizeof(SDL_Vertex); ++i )
+    {
+        hash = ( hash ^ bytes[i] ) * 16777619u;
+    }
+    return hash;
+}
+
+static bool SameRect( const SDL_Rect &a, const SDL_Rect &b )
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+static bool SameDraw( const DrawRecord &a, const DrawRecord &b )
+{
+    return a.mLayer == b.mLayer && a.mTexture == b.mTexture && SameRect( a.mSource, b.mSource ) &&
+           SameRect( a.mBounds, b.mBounds ) && a.mGeometryHash == b.mGeometryHash;
+}
+
+DirtyRegion::DirtyRegion( int width_, int height_ ): mWidth(width_), mHeight(height_), mMerged(true)
+{}
+
+void DirtyRegion::Add( const SDL_Rect &rect )
+{
+    SDL_Rect frame = { 0, 0, mWidth, mHeight };
+    SDL_Rect clipped;
+    if( SDL_IntersectRect( &rect, &frame, &clipped ) )
+    {
+        mRects.push_back( clipped );
+        mMerged = false;
+    }
+}
+
+void DirtyRegion::AddAll()
+{
+    SDL_Rect frame = { 0, 0, mWidth, mHeight };
+    mRects.clear();
+    mRects.push_back( frame );
+    mMerged = true;
+}
+
+void DirtyRegion::Clear()
+{
+    mRects.clear();
+    mMerged = true;
+}
+
+void DirtyRegion::Merge()
+{
+    //Too many rectangles to redraw one by one - redraw their bounding box
+    if( mRects.size() > DIRTY_MAX_RECTS )
+    {
+        for( size_t i = 1; i < mRects.size(); ++i )
+        {
+            SDL_UnionRect( &mRects[0], &mRects[i], &mRects[0] );
+        }
+        mRects.resize( 1 );
+    }
+    
+    //Replace every two overlapping rectangles by their bounding box, which may then overlap earlier ones
+    size_t i = 0;
+    while( i < mRects.size() )
+    {
+        bool grew = false;
+        size_t j = i + 1;
+        while( j < mRects.size() )
+        {
+            if( SDL_HasIntersection( &mRects[i], &mRects[j] ) )
+            {
+                SDL_UnionRect( &mRects[i], &mRects[j], &mRects[i] );
+                mRects[j] = mRects.back();
+                mRects.pop_back();
+                grew = true;
+            }
+            else
+            {
+                ++j;
+            }
+        }
+        i = grew ? 0 : i + 1;
+    }
+    mMerged = true;
+}
+
+const std::vector<SDL_Rect>& DirtyRegion::GetRects()
+{
+    if( !mMerged )
+    {
+        Merge();
+    }
+    return(mRects);
+}
+
+long DirtyRegion::GetArea()
+{
+    const std::vector<SDL_Rect> &rects = GetRects();
+    long area = 0;
+    for( size_t i = 0; i < rects.size(); ++i )
+    {
+        area += (long)rects[i].w * rects[i].h;
+    }
+    return(area);
+}
+
+double DirtyRegion::GetFraction()
+{
+    return (double)GetArea() / ( (double)mWidth * mHeight );
+}
+
+RenderQueue::RenderQueue(SDL_Renderer *mRenderer_): mRenderer(mRenderer_), mLastDrawCalls(0), mLastCommands(0), mDrawCalls(0)
+{}
+
+void RenderQueue::SetRenderer( SDL_Renderer *mRenderer_ )
+{
+    mRenderer = mRenderer_;
+}
+
+void RenderQueue::Push( int layer, const LTexture &texture, int x, int y, int w, int h )
+{
+    RenderCommand command;
+    command.mLayer = layer;
+    command.mTexture = texture.getTexture();
+    command.mOrder = (unsigned int)mCommands.size();
+    command.mTextureWidth = texture.getTextureWidth();
+    command.mTextureHeight = texture.getTextureHeight();
+    SDL_Rect dest = { x, y, w > 0 ? w : texture.getWidth(), h > 0 ? h : texture.getHeight() };
+    command.mSource = texture.getClip();
+    command.mDest = dest;
+    command.mBounds = dest;
+    command.mVertices = NULL;
+    command.mIndices = NULL;
+    mCommands.push_back( command );
+}
+
+void RenderQueue::PushGeometry( int layer, SDL_Texture *texture, const std::vector<SDL_Vertex> &vertices, const std::vector<int> &indices )
+{
+    if( indices.empty() )
+    {
+        return;
+    }
+    RenderCommand command;
+    command.mLayer = layer;
+    command.mTexture = texture;
+    command.mOrder = (unsigned int)mCommands.size();
+    command.mTextureWidth = 0;
+    command.mTextureHeight = 0;
+    command.mVertices = &vertices;
+    command.mIndices = &indices;
+    
+    //Bounding box of the vertices
+    float left = vertices[0].position.x, top = vertices[0].position.y, right = left, bottom = top;
+    for( size_t i = 1; i < vertices.size(); ++i )
+    {
+        left = std::min( left, vertices[i].position.x );
+        right = std::max( right, vertices[i].position.x );
+        top = std::min( top, vertices[i].position.y );
+        bottom = std::max( bottom, vertices[i].position.y );
+    }
+    command.mBounds.x = (int)floor( left );
+    command.mBounds.y = (int)floor( top );
+    command.mBounds.w = (int)ceil( right ) - command.mBounds.x;
+    command.mBounds.h = (int)ceil( bottom ) - command.mBounds.y;
+    mCommands.push_back( command );
+}
+
+void RenderQueue::CollectDirty( DirtyRegion &region, int minLayer )
+{
+    //The draws of this frame in submission order
+    mDraws.clear();
+    for( size_t i = 0; i < mCommands.size(); ++i )
+    {
+        const RenderCommand &command = mCommands[i];
+        if( command.mLayer < minLayer )
+        {
+            continue;
+        }
+        DrawRecord draw;
+        draw.mLayer = command.mLayer;
+        draw.mTexture = command.mTexture;
+        draw.mSource = command.mVertices == NULL ? command.mSource : SDL_Rect();
+        draw.mBounds = command.mBounds;
+        draw.mGeometryHash = command.mVertices == NULL ? 0 : HashVertices( *command.mVertices );
+        mDraws.push_back( draw );
+    }
+    
+    //A draw that is the same as the draw in its place last frame leaves the frame unchanged,
+    //otherwise both where it was and where it is now are dirty (draws that shifted places are simply redrawn)
+    size_t count = std::max( mDraws.size(), mLastDraws.size() );
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( i < mDraws.size() && i < mLastDraws.size() && SameDraw( mDraws[i], mLastDraws[i] ) )
+        {
+            continue;
+        }
+        if( i < mLastDraws.size() )
+        {
+            region.Add( mLastDraws[i].mBounds );
+        }
+        if( i < mDraws.size() )
+        {
+            region.Add( mDraws[i].mBounds );
+        }
+    }
+    mLastDraws.swap( mDraws );
+}
+
+void RenderQueue::Flush( const std::vector<SDL_Rect> *clips )
+{
+    mLastDrawCalls = 0;
+    mLastCommands = (unsigned int)mCommands.size();
+    
+    std::sort( mCommands.begin(), mCommands.end(), CommandLess );
+    
+    if( clips == NULL )
+    {
+        SubmitRuns( NULL );
+    }
+    else
+    {
+        //Redraw every clip rectangle with the draws that overlap it, the rest of the target keeps its pixels
+        for( size_t i = 0; i < clips->size(); ++i )
+        {
+            SDL_RenderSetClipRect( mRenderer, &(*clips)[i] );
+            SubmitRuns( &(*clips)[i] );
+        }
+        SDL_RenderSetClipRect( mRenderer, NULL );
+    }
+    
+    mDrawCalls += mLastDrawCalls;
+    mCommands.clear();
+}
+
+void RenderQueue::SubmitRuns( const SDL_Rect *clip )
+{
+    //Submit every run of draws with the same texture together - a run may span layers
+    //(e.g. every sprite layer drawn from the sprite atlas) since the draws stay in layer order
+    unsigned int begin = 0;
+    for( unsigned int i = 1; i <= mCommands.size(); ++i )
+    {
+        if( i == mCommands.size() || mCommands[i].mTexture != mCommands[begin].mTexture )
+        {
+            SubmitRun( begin, i, clip );
+            begin = i;
+        }
+    }
+}
+
+void RenderQueue::SubmitRun( unsigned int begin, unsigned int end, const SDL_Rect *clip )
+{
+    //Draws of the run that overlap the clip rectangle
+    unsigned int count = 0, single = begin;
+    for( unsigned int i = begin; i < end; ++i )
+    {
+        if( clip == NULL || SDL_HasIntersection( &mCommands[i].mBounds, clip ) )
+        {
+            ++count;
+            single = i;
+        }
+    }
+    if( count == 0 )
+    {
+        return;
+    }
+    
+    //A single sprite needs no geometry - plain copy
+    if( count == 1 && mCommands[single].mVertices == NULL )
+    {
+        SDL_RenderCopy( mRenderer, mCommands[single].mTexture, &mCommands[single].mSource, &mCommands[single].mDest );
+        ++mLastDrawCalls;
+        return;
+    }
+    
+    //Build two triangles per sprite and append the prebuilt geometry
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    mVertices.clear();
+    mIndices.clear();
+    for( unsigned int i = begin; i < end; ++i )
+    {
+        const RenderCommand &command = mCommands[i];
+        if( clip != NULL && !SDL_HasIntersection( &command.mBounds, clip ) )
+        {
+            continue;
+        }
+        int first = (int)mVertices.size();
+        
+        if( command.mVertices != NULL )
+        {
+            mVertices.insert( mVertices.end(), command.mVertices->begin(), command.mVertices->end() );
+            for( std::vector<int>::const_iterator it = command.mIndices->begin(); it != command.mIndices->end(); ++it )
+            {
+                mIndices.push_back( first + *it );
+            }
+            continue;
+        }
+        
+        float left = (float)command.mDest.x, top = (float)command.mDest.y;
+        float right = (float)( command.mDest.x + command.mDest.w ), bottom = (float)( command.mDest.y + command.mDest.h );
+        float u0 = (float)command.mSource.x / command.mTextureWidth, v0 = (float)command.mSource.y / command.mTextureHeight;
+        float u1 = (float)( command.mSource.x + command.mSource.w ) / command.mTextureWidth;
+        float v1 = (float)( command.mSource.y + command.mSource.h ) / command.mTextureHeight;
+        
+        SDL_Vertex corner;
+        corner.color = white;
+        corner.position.x = left;  corner.position.y = top;    corner.tex_coord.x = u0; corner.tex_coord.y = v0; mVertices.push_back( corner );
+        corner.position.x = right; corner.position.y = top;    corner.tex_coord.x = u1; corner.tex_coord.y = v0; mVertices.push_back( corner );
+        corner.position.x = right; corner.position.y = bottom; corner.tex_coord.x = u1; corner.tex_coord.y = v1; mVertices.push_back( corner );
+        corner.position.x = left;  corner.position.y = bottom; corner.tex_coord.x = u0; corner.tex_coord.y = v1; mVertices.push_back( corner );
+        
+        mIndices.push_back( first );     mIndices.push_back( first + 1 ); mIndices.push_back( first + 2 );
+        mIndices.push_back( first );     mIndices.push_back( first + 2 ); mIndices.push_back( first + 3 );
+    }
+    
+    SDL_RenderGeometry( mRenderer, mCommands[begin].mTexture, &mVertices[0], (int)mVertices.size(), &mIndices[0], (int)mIndices.size() );
+    ++mLastDrawCalls;
+}
+
+unsigned int RenderQueue::GetLastDrawCalls() const
+{
+    return(mLastDrawCalls);
+}
+
+unsigned int RenderQueue::GetLastCommands() const
+{
+    return(mLastCommands);
+}
+
+unsigned long RenderQueue::GetDrawCalls() const
+{
+    return(mDrawCalls);
+}
@@ -0,0 +1,137 @@
+//
+//  render.hpp
+//  Game
+//
+//  Render queue: draw calls are collected during the frame, sorted by layer and texture
+//  and submitted in batches - one SDL_RenderGeometry call per run of draws from the same texture.
+//  For partial redraws the queue also finds the parts of the frame that changed since the last frame.
+//
+
+#ifndef render_h
+#define render_h
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <vector>
+
+class LTexture;
+class DirtyRegion;
+
+//More dirty rectangles than this are redrawn as their bounding box
+const unsigned int DIRTY_MAX_RECTS = 64;
+
+//Draw layers, drawn from the lowest to the highest
+enum RenderLayer
+{
+    LAYER_BACKGROUND,
+    LAYER_PARACHUTISTS,
+    LAYER_BOAT,
+    LAYER_AIRPLANE,
+    LAYER_HUD,
+    LAYER_GAMEOVER
+};
+
+//One draw collected by the queue
+struct RenderCommand
+{
+    int mLayer; //layer the draw belongs to
+    SDL_Texture *mTexture; //texture to draw from
+    unsigned int mOrder; //submission order (keeps draws of the same layer and texture in order)
+    int mTextureWidth, mTextureHeight; //texture size (to turn the source into texture coordinates)
+    SDL_Rect mSource; //part of the texture to draw
+    SDL_Rect mDest; //where on the screen
+    SDL_Rect mBounds; //part of the screen the draw covers (mDest for sprites)
+    const std::vector<SDL_Vertex> *mVertices; //prebuilt geometry instead of a sprite (NULL for sprites)
+    const std::vector<int> *mIndices;
+};
+
+//What a draw of the last frame looked like - a draw that looks the same in the next frame needs no redraw
+struct DrawRecord
+{
+    int mLayer;
+    SDL_Texture *mTexture;
+    SDL_Rect mSource; //part of the texture drawn (sprites)
+    SDL_Rect mBounds; //part of the screen covered
+    uint32_t mGeometryHash; //hash of the vertices (geometry)
+};
+
+//Parts of a frame that must be redrawn, merged into a few non overlapping rectangles
+class DirtyRegion
+{
+public:
+    //Constructor: a region on a width_ x height_ frame
+    DirtyRegion( int width_, int height_ );
+    
+    //Adds a rectangle (clipped to the frame)
+    void Add( const SDL_Rect &rect );
+    //Adds the whole frame
+    void AddAll();
+    //Empties the region
+    void Clear();
+    
+    //The rectangles covering the region - no two of them overlap
+    const std::vector<SDL_Rect> &GetRects();
+    //Pixels the region covers and the part of the frame that is
+    long GetArea();
+    double GetFraction();
+    
+private:
+    
+    //Merges overlapping rectangles until none overlap
+    void Merge();
+    
+    int mWidth, mHeight; //frame dimensions
+    std::vector<SDL_Rect> mRects;
+    bool mMerged; //set when mRects has no overlaps
+};
+
+class RenderQueue
+{
+public:
+    //Constructor: Initializes the variables
+    RenderQueue(SDL_Renderer *mRenderer_ = NULL);
+    
+    //Sets the renderer the queue submits to
+    void SetRenderer( SDL_Renderer *mRenderer_ );
+    
+    //Queues a sprite - the whole image (its atlas region for an atlas view) at x, y (stretched to w, h when given)
+    void Push( int layer, const LTexture &texture, int x, int y, int w = 0, int h = 0 );
+    
+    //Queues prebuilt textured triangles, the vectors must stay valid until Flush
+    void PushGeometry( int layer, SDL_Texture *texture, const std::vector<SDL_Vertex> &vertices, const std::vector<int> &indices );
+    
+    //Adds the parts of the frame where the queued draws of minLayer and above differ from the last call
+    //(what was drawn there last frame and what is drawn now), call before Flush
+    void CollectDirty( DirtyRegion &region, int minLayer );
+    
+    //Sorts the queued draws, submits them and empties the queue.
+    //With clip rectangles only those parts of the target are drawn, each with the draws that overlap it.
+    void Flush( const std::vector<SDL_Rect> *clips = NULL );
+    
+    //Draw call statistics
+    unsigned int GetLastDrawCalls() const; //draw calls of the last Flush
+    unsigned int GetLastCommands() const; //draws queued for the last Flush
+    unsigned long GetDrawCalls() const; //draw calls since the start
+    
+private:
+    
+    RenderQueue( const RenderQueue &other_); //disable copy constructor
+    
+    //Submits the sorted commands in runs that share a texture (only the ones overlapping clip when given)
+    void SubmitRuns( const SDL_Rect *clip );
+    //Submits commands [begin, end) that share a texture (only the ones overlapping clip when given)
+    void SubmitRun( unsigned int begin, unsigned int end, const SDL_Rect *clip );
+    
+    SDL_Renderer *mRenderer; //renderer the queue submits to
+    std::vector<RenderCommand> mCommands; //draws of the current frame
+    std::vector<SDL_Vertex> mVertices; //batch being built (kept between frames)
+    std::vector<int> mIndices;
+    std::vector<DrawRecord> mLastDraws; //draws of the last CollectDirty
+    std::vector<DrawRecord> mDraws; //draws of the current CollectDirty (kept between frames)
+    
+    unsigned int mLastDrawCalls;
+    unsigned int mLastCommands;
+    unsigned long mDrawCalls;
+};
+
+#endif /* render_h */
@@ -0,0 +1,251 @@
+//
+//  replay.cpp
+//  Game
+//
+
+#include <stdexcept>
+#include <string.h>
+
+#include "replay.hpp"
+
+//Input log header
+static const char INPUT_LOG_MAGIC[4] = { 'P', 'R', 'P', 'L' };
+const unsigned char INPUT_LOG_VERSION = 2;
+//Logs of version 1 have no scenario (they are games of the original scenario)
+const unsigned char INPUT_LOG_VERSION_CLASSIC = 1;
+//Key code of the end record
+const unsigned char INPUT_LOG_END = 0xFF;
+
+static void WriteBytes( FILE *file, uint64_t value, int size )
+{
+    for( int i = 0; i < size; ++i )
+    {
+        fputc( (int)( ( value >> ( 8 * i ) ) & 0xFF ), file );
+    }
+}
+
+//Reads little endian values and varints from the log, throws when the log is cut short
+class InputLogReader
+{
+public:
+    InputLogReader( const std::vector<unsigned char> &data_ ): mData(data_), mOffset(0) {}
+    
+    bool AtEnd() const { return mOffset >= mData.size(); }
+    
+    uint64_t ReadBytes( int size )
+    {
+        if( mOffset + size > mData.size() )
+        {
+            throw std::runtime_error("Input log is truncated!\n");
+        }
+        uint64_t value = 0;
+        for( int i = 0; i < size; ++i )
+        {
+            value |= (uint64_t)mData[mOffset++] << ( 8 * i );
+        }
+        return value;
+    }
+    
+    unsigned long ReadVarint()
+    {
+        unsigned long value = 0;
+        for( int shift = 0; ; shift += 7 )
+        {
+            unsigned char byte = (unsigned char)ReadBytes( 1 );
+            value |= (unsigned long)( byte & 0x7F ) << shift;
+            if( ( byte & 0x80 ) == 0 )
+            {
+                return value;
+            }
+        }
+    }
+    
+private:
+    const std::vector<unsigned char> &mData;
+    size_t mOffset;
+};
+
+InputRecorder::InputRecorder( const std::string &path_, const GameConfig &config_ ): mLastTick(0), mCount(0)
+{
+    std::string errormsg;
+    
+    mFile = fopen( path_.c_str(), "wb" );
+    if( mFile == NULL )
+    {
+        errormsg = "Unable to create input log ";
+        errormsg.append(path_);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    
+    fwrite( INPUT_LOG_MAGIC, 1, sizeof(INPUT_LOG_MAGIC), mFile );
+    fputc( INPUT_LOG_VERSION, mFile );
+    WriteBytes( mFile, config_.mSeed, 8 );
+    WriteBytes( mFile, config_.mMaxParachutists, 4 );
+    const Scenario &scenario = config_.mScenario;
+    WriteBytes( mFile, scenario.mAirplanes, 4 );
+    WriteBytes( mFile, scenario.mJumpsPerPass, 4 );
+    WriteBytes( mFile, (uint32_t)scenario.mAirplaneVel, 4 );
+    WriteBytes( mFile, (uint32_t)scenario.mMinFallVel, 4 );
+    WriteBytes( mFile, (uint32_t)scenario.mMaxFallVel, 4 );
+    WriteBytes( mFile, scenario.mWaveInterval, 4 );
+    WriteBytes( mFile, scenario.mWaveSize, 4 );
+    WriteBytes( mFile, scenario.mEndless ? 1 : 0, 1 );
+}
+
+InputRecorder::~InputRecorder()
+{
+    if( mFile != NULL )
+    {
+        fclose( mFile );
+    }
+}
+
+void InputRecorder::WriteVarint( unsigned long value_ )
+{
+    while( value_ >= 0x80 )
+    {
+        fputc( (int)( ( value_ & 0x7F ) | 0x80 ), mFile );
+        value_ >>= 7;
+    }
+    fputc( (int)value_, mFile );
+}
+
+void InputRecorder::Record( unsigned long tick_, BoatKey key_, bool down_ )
+{
+    if( mFile == NULL )
+    {
+        return;
+    }
+    WriteVarint( tick_ - mLastTick );
+    fputc( key_ * 2 + ( down_ ? 1 : 0 ), mFile );
+    mLastTick = tick_;
+    ++mCount;
+}
+
+void InputRecorder::Finish( const Simulation &sim_ )
+{
+    if( mFile == NULL )
+    {
+        return;
+    }
+    WriteVarint( sim_.GetTickCount() - mLastTick );
+    fputc( INPUT_LOG_END, mFile );
+    WriteBytes( mFile, sim_.GetStateHash(), 8 );
+    fclose( mFile );
+    mFile = NULL;
+}
+
+unsigned long InputRecorder::GetCount() const
+{
+    return(mCount);
+}
+
+InputReplay::InputReplay( const std::string &path_ ): mSeed(0), mMaxParachutists(0), mNext(0), mEndTick(0), mHasEnd(false), mEndHash(0)
+{
+    std::string errormsg;
+    
+    //Read the whole log
+    FILE *file = fopen( path_.c_str(), "rb" );
+    if( file == NULL )
+    {
+        errormsg = "Unable to open input log ";
+        errormsg.append(path_);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[4096];
+    size_t read;
+    while( ( read = fread( buffer, 1, sizeof(buffer), file ) ) > 0 )
+    {
+        data.insert( data.end(), buffer, buffer + read );
+    }
+    fclose( file );
+    
+    InputLogReader reader( data );
+    char magic[sizeof(INPUT_LOG_MAGIC)];
+    for( size_t i = 0; i < sizeof(magic); ++i )
+    {
+        magic[i] = (char)reader.ReadBytes( 1 );
+    }
+    uint64_t version = memcmp( magic, INPUT_LOG_MAGIC, sizeof(magic) ) == 0 ? reader.ReadBytes( 1 ) : 0;
+    if( version != INPUT_LOG_VERSION && version != INPUT_LOG_VERSION_CLASSIC )
+    {
+        errormsg = "Not an input log: ";
+        errormsg.append(path_);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    mSeed = reader.ReadBytes( 8 );
+    mMaxParachutists = (unsigned int)reader.ReadBytes( 4 );
+    if( version == INPUT_LOG_VERSION )
+    {
+        mScenario.mAirplanes = (unsigned int)reader.ReadBytes( 4 );
+        mScenario.mJumpsPerPass = (unsigned int)reader.ReadBytes( 4 );
+        mScenario.mAirplaneVel = (int32_t)reader.ReadBytes( 4 );
+        mScenario.mMinFallVel = (int32_t)reader.ReadBytes( 4 );
+        mScenario.mMaxFallVel = (int32_t)reader.ReadBytes( 4 );
+        mScenario.mWaveInterval = (unsigned int)reader.ReadBytes( 4 );
+        mScenario.mWaveSize = (unsigned int)reader.ReadBytes( 4 );
+        mScenario.mEndless = reader.ReadBytes( 1 ) != 0;
+    }
+    
+    //Transitions until the end record (a log without one, e.g. the game crashed, ends at its last transition)
+    unsigned long tick = 0;
+    while( !reader.AtEnd() )
+    {
+        tick += reader.ReadVarint();
+        unsigned char code = (unsigned char)reader.ReadBytes( 1 );
+        if( code == INPUT_LOG_END )
+        {
+            mHasEnd = true;
+            mEndHash = reader.ReadBytes( 8 );
+            break;
+        }
+        
+        InputTransition transition;
+        transition.mTick = tick;
+        transition.mKey = (BoatKey)( code / 2 );
+        transition.mDown = ( code & 1 ) != 0;
+        mTransitions.push_back( transition );
+    }
+    mEndTick = tick;
+}
+
+GameConfig InputReplay::GetConfig( const GameConfig &config_ ) const
+{
+    GameConfig config = config_;
+    config.mSeed = mSeed;
+    config.mMaxParachutists = mMaxParachutists;
+    config.mScenario = mScenario;
+    return config;
+}
+
+void InputReplay::Update( Simulation &sim_ )
+{
+    while( mNext < mTransitions.size() && mTransitions[mNext].mTick <= sim_.GetTickCount() )
+    {
+        const InputTransition &transition = mTransitions[mNext++];
+        if( transition.mDown )
+        {
+            sim_.KeyDown( transition.mKey );
+        }
+        else
+        {
+            sim_.KeyUp( transition.mKey );
+        }
+    }
+}
+
+bool InputReplay::IsFinished( const Simulation &sim_ ) const
+{
+    return sim_.GetTickCount() >= mEndTick;
+}
+
+bool InputReplay::Verify( const Simulation &sim_ ) const
+{
+    return mHasEnd && sim_.GetTickCount() == mEndTick && sim_.GetStateHash() == mEndHash;
+}
+
+unsigned long InputReplay::GetLength() const
+{
+    return(mEndTick);
+}
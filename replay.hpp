@@ -0,0 +1,95 @@
+//
+//  replay.hpp
+//  Game
+//
+//  Input log of a game: the boat key transitions by tick, recorded to and replayed from a compact binary file.
+//  With the same seed and the same key transitions the simulation runs exactly the same ticks.
+//
+//  File format (little endian):
+//      header: "PRPL", version byte, seed (8 bytes), parachutist pool capacity (4 bytes),
+//              scenario: airplanes, jumps per pass, airplane speed, min and max fall speed,
+//              wave interval, wave size (4 bytes each), endless byte (version 1 logs have no scenario)
+//      transitions: tick delta (varint), key code byte (key * 2 + 1 when pressed)
+//      end: tick delta (varint), INPUT_LOG_END byte, state hash of the last tick (8 bytes)
+//
+
+#ifndef replay_h
+#define replay_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "simulation.hpp"
+
+//A key press or release before a tick
+struct InputTransition
+{
+    unsigned long mTick; //ticks simulated when the key changed
+    BoatKey mKey; //key that changed
+    bool mDown; //pressed or released
+};
+
+//Writes the key transitions of a game to an input log
+class InputRecorder
+{
+public:
+    //Constructor: creates the log file (throws if it cannot be created)
+    InputRecorder( const std::string &path_, const GameConfig &config_ );
+    //Destructor: closes the log (a log that was not finished has no end record)
+    ~InputRecorder();
+    
+    //Adds a key transition before the given tick
+    void Record( unsigned long tick_, BoatKey key_, bool down_ );
+    //Writes the end record with the state of the simulation and closes the log
+    void Finish( const Simulation &sim_ );
+    
+    //Number of transitions recorded
+    unsigned long GetCount() const;
+    
+private:
+    
+    InputRecorder( const InputRecorder &other_); //disable copy constructor
+    
+    void WriteVarint( unsigned long value_ );
+    
+    FILE *mFile; //the log (NULL once finished)
+    unsigned long mLastTick; //tick of the previous record
+    unsigned long mCount;
+};
+
+//Reads an input log and feeds its key transitions to a simulation
+class InputReplay
+{
+public:
+    //Constructor: reads the whole log (throws if it cannot be read)
+    InputReplay( const std::string &path_ );
+    
+    //The options the recorded game ran with (seed, pool capacity and scenario), the others are kept from config_
+    GameConfig GetConfig( const GameConfig &config_ ) const;
+    
+    //Applies the transitions of the coming tick (call before every Simulation::Tick)
+    void Update( Simulation &sim_ );
+    //True once the simulation reached the last recorded tick
+    bool IsFinished( const Simulation &sim_ ) const;
+    //True if the simulation ended in the recorded state (false if the log had no end record)
+    bool Verify( const Simulation &sim_ ) const;
+    
+    //Recorded length in ticks
+    unsigned long GetLength() const;
+    
+private:
+    
+    uint64_t mSeed; //seed of the recorded game
+    unsigned int mMaxParachutists; //pool capacity of the recorded game
+    Scenario mScenario; //scenario of the recorded game
+    std::vector<InputTransition> mTransitions; //all transitions by tick
+    size_t mNext; //first transition not applied yet
+    unsigned long mEndTick; //last tick of the log
+    bool mHasEnd; //the log was finished
+    uint64_t mEndHash; //state hash at the end tick
+};
+
+#endif /* replay_h */
@@ -0,0 +1,175 @@
+//
+//  scenario.cpp
+//  Game
+//
+
+#include "scenario.hpp"
+#include "simulation.hpp" // use of SCREEN_WIDTH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+
+//A built-in scenario
+struct ScenarioPreset
+{
+    const char *mName;
+    const char *mDescription;
+    unsigned int mAirplanes, mJumpsPerPass;
+    int mAirplaneVel, mMinFallVel, mMaxFallVel;
+    unsigned int mWaveInterval, mWaveSize;
+    bool mEndless;
+    unsigned int mMaxParachutists;
+};
+
+//The stress presets drop waves every tick or two, sized so about that many parachutists are alive at once
+static const ScenarioPreset SCENARIO_PRESETS[] =
+{
+    { "classic", "the original game: one airplane, one jump per pass", 1, 1, 10, 4, 4, 0, 0, false, 0 },
+    { "busy", "three airplanes, two jumps per pass, fall speeds 3 to 6", 3, 2, 10, 3, 6, 0, 0, false, 0 },
+    { "stress-500", "endless, about 500 parachutists alive", 3, 2, 10, 3, 6, 2, 5, true, 4096 },
+    { "stress-10k", "endless, about 10000 parachutists alive", 3, 2, 10, 3, 6, 1, 52, true, 16384 },
+    { "stress-100k", "endless, about 100000 parachutists alive", 3, 2, 10, 3, 6, 1, 528, true, 131072 }
+};
+
+static const size_t SCENARIO_PRESET_COUNT = sizeof(SCENARIO_PRESETS) / sizeof(SCENARIO_PRESETS[0]);
+
+bool FindScenario( const char *name, Scenario *scenario )
+{
+    for( size_t i = 0; i < SCENARIO_PRESET_COUNT; ++i )
+    {
+        const ScenarioPreset &preset = SCENARIO_PRESETS[i];
+        if( strcmp( name, preset.mName ) == 0 )
+        {
+            scenario->mAirplanes = preset.mAirplanes;
+            scenario->mJumpsPerPass = preset.mJumpsPerPass;
+            scenario->mAirplaneVel = preset.mAirplaneVel;
+            scenario->mMinFallVel = preset.mMinFallVel;
+            scenario->mMaxFallVel = preset.mMaxFallVel;
+            scenario->mWaveInterval = preset.mWaveInterval;
+            scenario->mWaveSize = preset.mWaveSize;
+            scenario->mEndless = preset.mEndless;
+            scenario->mMaxParachutists = preset.mMaxParachutists;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Removes the white space around a part of a line
+static std::string Trim( const std::string &text )
+{
+    size_t begin = text.find_first_not_of( " \t\r\n" );
+    if( begin == std::string::npos )
+    {
+        return std::string();
+    }
+    size_t end = text.find_last_not_of( " \t\r\n" );
+    return text.substr( begin, end - begin + 1 );
+}
+
+//Throws the error of a bad scenario file (at a line unless line is 0)
+static void ScenarioError( const std::string &path, int line, const char *message )
+{
+    std::string errormsg = path;
+    if( line > 0 )
+    {
+        char number[16];
+        snprintf( number, sizeof(number), ":%d", line );
+        errormsg.append(number);
+    }
+    errormsg.append(": ");
+    errormsg.append(message);
+    throw std::runtime_error(errormsg.c_str());
+}
+
+Scenario LoadScenarioFile( const std::string &path )
+{
+    FILE *file = fopen( path.c_str(), "r" );
+    if( file == NULL )
+    {
+        std::string errormsg = "Unable to open scenario ";
+        errormsg.append(path);
+        throw std::runtime_error(errormsg.c_str());
+    }
+    
+    Scenario scenario;
+    char buffer[256];
+    int line = 0;
+    std::string error;
+    while( error.empty() && fgets( buffer, sizeof(buffer), file ) != NULL )
+    {
+        ++line;
+        std::string text = buffer;
+        size_t comment = text.find( '#' );
+        if( comment != std::string::npos )
+        {
+            text.erase( comment );
+        }
+        text = Trim( text );
+        if( text.empty() )
+        {
+            continue;
+        }
+        
+        size_t equals = text.find( '=' );
+        if( equals == std::string::npos )
+        {
+            error = "expected key = value";
+            break;
+        }
+        std::string key = Trim( text.substr( 0, equals ) );
+        std::string value = Trim( text.substr( equals + 1 ) );
+        char *end = NULL;
+        long number = strtol( value.c_str(), &end, 10 );
+        if( value.empty() || *end != '\0' || number < 0 )
+        {
+            error = "expected a number that is not negative";
+            break;
+        }
+        
+        if( key == "airplanes" ) scenario.mAirplanes = (unsigned int)number;
+        else if( key == "jumps_per_pass" ) scenario.mJumpsPerPass = (unsigned int)number;
+        else if( key == "airplane_speed" ) scenario.mAirplaneVel = (int)number;
+        else if( key == "min_fall_speed" ) scenario.mMinFallVel = (int)number;
+        else if( key == "max_fall_speed" ) scenario.mMaxFallVel = (int)number;
+        else if( key == "wave_interval" ) scenario.mWaveInterval = (unsigned int)number;
+        else if( key == "wave_size" ) scenario.mWaveSize = (unsigned int)number;
+        else if( key == "endless" ) scenario.mEndless = number != 0;
+        else if( key == "max_parachutists" ) scenario.mMaxParachutists = (unsigned int)number;
+        else
+        {
+            error = "unknown key " + key;
+        }
+    }
+    fclose( file );
+    
+    if( error.empty() )
+    {
+        //Speeds of 0 would freeze the airplanes or the parachutists
+        if( scenario.mAirplaneVel < 1 || scenario.mMinFallVel < 1 || scenario.mMaxFallVel < scenario.mMinFallVel )
+        {
+            error = "speeds must be at least 1 and min_fall_speed at most max_fall_speed";
+        }
+        //Every jump of a pass takes at least one airplane step over the screen
+        else if( (long)scenario.mJumpsPerPass * scenario.mAirplaneVel > SCREEN_WIDTH )
+        {
+            error = "jumps_per_pass times airplane_speed must be at most the screen width";
+        }
+        line = 0;
+    }
+    if( !error.empty() )
+    {
+        ScenarioError( path, line, error.c_str() );
+    }
+    return scenario;
+}
+
+void PrintScenarios()
+{
+    for( size_t i = 0; i < SCENARIO_PRESET_COUNT; ++i )
+    {
+        printf( "%-12s %s\n", SCENARIO_PRESETS[i].mName, SCENARIO_PRESETS[i].mDescription );
+    }
+}
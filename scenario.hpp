@@ -0,0 +1,37 @@
+//
+//  scenario.hpp
+//  Game
+//
+//  Scenarios: what the game spawns - how many airplanes cross the screen, how many parachutists
+//  each drops per pass, how fast they fall and the waves of parachutists dropped on a schedule.
+//  A scenario is a built-in preset or a text file of "key = value" lines, e.g.
+//
+//      # three airplanes and a wave of 20 parachutists every second
+//      airplanes = 3
+//      jumps_per_pass = 2
+//      min_fall_speed = 3
+//      max_fall_speed = 6
+//      wave_interval = 60
+//      wave_size = 20
+//
+//  Keys: airplanes, jumps_per_pass, airplane_speed, min_fall_speed, max_fall_speed,
+//  wave_interval, wave_size, endless (0 or 1), max_parachutists. Missing keys keep the original game values.
+//
+
+#ifndef scenario_h
+#define scenario_h
+
+#include <string>
+
+#include "config.hpp"
+
+//Finds a built-in scenario by name - returns false for an unknown name
+bool FindScenario( const char *name, Scenario *scenario );
+
+//Reads a scenario file (throws when the file can not be read or has a bad line)
+Scenario LoadScenarioFile( const std::string &path );
+
+//Prints the built-in scenarios
+void PrintScenarios();
+
+#endif /* scenario_h */
@@ -0,0 +1,72 @@
+//
+//  scenario_test.cpp
+//  Game
+//
+//  Test of the scenario airplanes: every full pass over the screen drops exactly the jumps per pass
+//  of the scenario, whatever jump points the seed draws.
+//
+
+#include <stdio.h>
+
+#include "config.hpp"
+#include "simulation.hpp"
+
+//Seeds every jump count is played with
+const unsigned int TEST_SEEDS = 200;
+//Full passes checked per seed
+const int TEST_PASSES = 2;
+
+//Ticks until the airplane wraps around to the right of the screen again
+static void RunToNextPass( Simulation &sim )
+{
+    int posX = sim.GetAirplane( 0 ).GetPosX();
+    for( ;; )
+    {
+        sim.Tick();
+        int next = sim.GetAirplane( 0 ).GetPosX();
+        if( next > posX )
+        {
+            return;
+        }
+        posX = next;
+    }
+}
+
+int main()
+{
+    //The most jumps a pass fits is one per airplane step
+    const unsigned int jumps[] = { 2, 5, 20, SCREEN_WIDTH / 10 };
+    int failures = 0;
+    
+    for( size_t j = 0; j < sizeof(jumps) / sizeof(jumps[0]); ++j )
+    {
+        for( unsigned int seed = 1; seed <= TEST_SEEDS; ++seed )
+        {
+            //One airplane and parachutists slow enough that none lands or is caught during the test
+            GameConfig config;
+            config.mSeed = seed;
+            config.mScenario.mJumpsPerPass = jumps[j];
+            config.mScenario.mMinFallVel = config.mScenario.mMaxFallVel = 1;
+            config.mScenario.mEndless = true;
+            config.mMaxParachutists = ( TEST_PASSES + 1 ) * jumps[j];
+            Simulation sim( config );
+            
+            //The first pass starts part of the way over the screen
+            RunToNextPass( sim );
+            for( int pass = 0; pass < TEST_PASSES; ++pass )
+            {
+                unsigned int before = sim.GetParachutists().GetCount();
+                RunToNextPass( sim );
+                unsigned int dropped = sim.GetParachutists().GetCount() - before;
+                if( dropped != jumps[j] )
+                {
+                    printf( "Seed %u: a pass of %u jumps dropped %u parachutists\n", seed, jumps[j], dropped );
+                    ++failures;
+                }
+            }
+        }
+    }
+    
+    printf( "Airplane passes: %d failed\n", failures );
+    return failures == 0 ? 0 : 1;
+}
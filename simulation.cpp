@@ -0,0 +1,1055 @@
+//
+//  simulation.cpp
+//  Game
+//
+
+#include <string.h>//use of memcpy and memset
+#include <math.h>//use of floor and ceil
+#include <algorithm>//use of min and max
+
+#include "simulation.hpp"
+#include "kernel.hpp"
+#include "replay.hpp"
+#include "telemetry.hpp"
+
+//Sprite metadata - must match the image files (checked when the game loads the textures)
+const SpriteInfo SPRITES[SPRITE_COUNT] =
+{
+    { "boatF.png", 200, 207 },
+    { "airplaneF.png", 150, 104 },
+    { "parachutistF.png", 120, 240 },
+    { "gameover.png", 420, 420 }
+};
+
+AnimatedItem::AnimatedItem(Simulation *mSimPtr_, SpriteId Sprite_, int PosX_, int PosY_, int Vel_, int VelX_, int VelY_, bool Alive_) :
+                                            mSimPtr(mSimPtr_),
+                                            mSprite(Sprite_),
+                                            mWidth(SPRITES[Sprite_].mWidth),
+                                            mHeight(SPRITES[Sprite_].mHeight),
+                                            mPosX(PosX_), //Initialize the offsets
+								  			mPosY(PosY_), 
+                                            mPrevPosX(PosX_),
+                                            mPrevPosY(PosY_),
+											mVel(Vel_), //Initialize the Max Velocity
+											mVelX(VelX_), //Initialize the velocity
+											mVelY(VelY_), //Initialize the velocity
+                                            mAlive(Alive_)
+{}
+
+void AnimatedItem::SavePosition()
+{
+    mPrevPosX = mPosX;
+    mPrevPosY = mPosY;
+}
+
+//return Position Y of AnimatedItem
+int AnimatedItem::GetPosY() const
+{
+	return(mPosY);
+}
+
+//return Position X of AnimatedItem
+int AnimatedItem::GetPosX() const
+{
+	return(mPosX);
+}
+
+//return Position Y of AnimatedItem on the previous tick
+int AnimatedItem::GetPrevPosY() const
+{
+	return(mPrevPosY);
+}
+
+//return Position X of AnimatedItem on the previous tick
+int AnimatedItem::GetPrevPosX() const
+{
+	return(mPrevPosX);
+}
+
+//return velocity of AnimatedItem
+int AnimatedItem::GetVel() const
+{
+	return(mVel);
+}
+
+//return the current X velocity of AnimatedItem
+int AnimatedItem::GetVelX() const
+{
+	return(mVelX);
+}
+
+//return width of AnimatedItem
+int AnimatedItem::GetWidth() const
+{
+	return(mWidth);
+}
+
+//return height of AnimatedItem
+int AnimatedItem::GetHeight() const
+{
+	return(mHeight);
+}
+
+//return the sprite of AnimatedItem
+SpriteId AnimatedItem::GetSprite() const
+{
+	return(mSprite);
+}
+
+bool AnimatedItem::IsAlive() const
+{
+    return(mAlive);
+}
+
+ItemState AnimatedItem::GetState() const
+{
+    ItemState state;
+    state.mPosX = mPosX;
+    state.mPosY = mPosY;
+    state.mPrevPosX = mPrevPosX;
+    state.mPrevPosY = mPrevPosY;
+    state.mVelX = mVelX;
+    state.mVelY = mVelY;
+    state.mAlive = mAlive ? 1 : 0;
+    return(state);
+}
+
+void AnimatedItem::SetState( const ItemState &state_ )
+{
+    mPosX = state_.mPosX;
+    mPosY = state_.mPosY;
+    mPrevPosX = state_.mPrevPosX;
+    mPrevPosY = state_.mPrevPosY;
+    mVelX = state_.mVelX;
+    mVelY = state_.mVelY;
+    mAlive = state_.mAlive != 0;
+}
+
+Boat::Boat(Simulation *mSimPtr_): AnimatedItem(mSimPtr_, SPRITE_BOAT, 0, 400, 10)
+{}
+
+void Boat::move()
+{
+    //Move the Boat left or right
+    mPosX += mVelX;
+
+    //If the Boat went too far to the left or right
+    if( ( mPosX < 0 ) || ( mPosX + mWidth > SCREEN_WIDTH ) )
+    {
+        //Move back
+        mPosX -= mVelX;
+    }
+
+}
+
+void Boat::KeyDown( BoatKey key )
+{
+    //Adjust the velocity
+    switch( key )
+    {
+        case BOAT_KEY_LEFT: mVelX -= mVel; break;
+        case BOAT_KEY_RIGHT: mVelX += mVel; break;
+    }
+}
+
+void Boat::KeyUp( BoatKey key )
+{
+    //Adjust the velocity
+    switch( key )
+    {
+        case BOAT_KEY_LEFT: mVelX += mVel; break;
+        case BOAT_KEY_RIGHT: mVelX -= mVel; break;
+    }
+}
+
+//Airplane constructor 
+Airplane::Airplane(Simulation *mSimPtr_, const Scenario &scenario_, unsigned int index_, unsigned int count_):
+            AnimatedItem(mSimPtr_, SPRITE_AIRPLANE, (240 + (int)( index_ * SCREEN_WIDTH / count_ )) % SCREEN_WIDTH, 10, scenario_.mAirplaneVel),
+            mJumpsPerPass(scenario_.mJumpsPerPass),
+            mJumpsLeft(scenario_.mJumpsPerPass)
+{
+	mJumpXPos = mSimPtr->mRandom.NextBelow( SCREEN_WIDTH ); // save a random location when the parashutist will jump
+}
+
+void Airplane::move()
+{
+    //Move the airplane to the left 
+    mPosX -= mVel;
+	
+    //if airplane reached to the location of the parachutist jump
+    if( mJumpsLeft > 0 && (mPosX >= mJumpXPos) && (mPosX < (mJumpXPos + mVel)) ) // taking into account position move in  mVel jumps
+    {
+    	mSimPtr->createParachutist(mJumpXPos); // make the parachutist jump
+    	
+    	//The next jump of this pass is somewhere left of the airplane
+    	if( --mJumpsLeft > 0 && !DrawJumpXPos() )
+    	{
+    	    mJumpsLeft = 0; // no screen left to jump over (the first pass starts part of the way over)
+    	}
+    }
+
+    //If the airplane exit the screen from the left
+    if( (mPosX + mWidth ) < 0 ) 
+    {
+        //Move back to the right of the screen
+        mPosX = SCREEN_WIDTH;	
+        mJumpsLeft = mJumpsPerPass;
+        if( mJumpsPerPass == 1 )
+        {
+            mJumpXPos = mSimPtr->mRandom.NextBelow( SCREEN_WIDTH ); // save a random location when the parashutist will jump
+        }
+        else if( !DrawJumpXPos() )
+        {
+            mJumpsLeft = 0; // more jumps than steps over the screen (scenario files are checked against that)
+        }
+    }
+}
+
+bool Airplane::DrawJumpXPos()
+{
+    //The airplane checks its jump point at mPosX - mVel next, and every later jump of the pass needs a step of its own
+    int lowest = (int)( mJumpsLeft - 1 ) * mVel;
+    int highest = mPosX - mVel;
+    if( highest < lowest )
+    {
+        return false;
+    }
+    mJumpXPos = lowest + (int)mSimPtr->mRandom.NextBelow( (uint32_t)( highest - lowest + 1 ) );
+    return true;
+}
+
+AirplaneState Airplane::GetAirplaneState() const
+{
+    AirplaneState state;
+    state.mItem = GetState();
+    state.mJumpXPos = mJumpXPos;
+    state.mJumpsLeft = (int32_t)mJumpsLeft;
+    return(state);
+}
+
+void Airplane::SetAirplaneState( const AirplaneState &state_ )
+{
+    SetState( state_.mItem );
+    mJumpXPos = state_.mJumpXPos;
+    mJumpsLeft = (unsigned int)state_.mJumpsLeft;
+}
+
+//
+Parachutist::Parachutist(Simulation *mSimPtr_, int PosX_, int Vel_): AnimatedItem(mSimPtr_, SPRITE_PARACHUTIST, PosX_, 0, Vel_)
+{}
+
+bool Parachutist::IsOutOfRange(const Parachutist *parachutist_)
+{
+	//If the parachutist reach the bottom
+	return (parachutist_->mPosY - parachutist_->GetHeight() ) > SCREEN_HEIGHT ;
+}
+
+ParachutistPool::ParachutistPool(Simulation *mSimPtr_, unsigned int capacity_):
+                                    mSimPtr(mSimPtr_),
+                                    mCount(0),
+                                    mPosX(capacity_), mPosY(capacity_),
+                                    mPrevPosX(capacity_), mPrevPosY(capacity_),
+                                    mVel(capacity_),
+                                    mWidth(capacity_), mHeight(capacity_),
+                                    mLegLeft(capacity_), mLegRight(capacity_),
+                                    mFlags(capacity_),
+                                    mMaxVel(0),
+                                    mMinHeight(0),
+                                    mMaxHeight(0),
+                                    mLastNarrowTests(0),
+                                    mSlotOf(capacity_, 0),
+                                    mSlots(capacity_),
+                                    mFreeSlot(0),
+                                    mHighWaterMark(0),
+                                    mDropped(0)
+{
+    //Chain all slots in the free list
+    for( unsigned int i = 0; i < capacity_; ++i )
+    {
+        mSlots[i].mIndex = i + 1;
+        mSlots[i].mGeneration = 0;
+    }
+    mCandidates.reserve( capacity_ );
+}
+
+bool ParachutistPool::Add( const Parachutist &parachutist_, ParachutistHandle *handle_ )
+{
+    //Pool is full - drop the parachutist
+    if( mCount == mSlots.size() )
+    {
+        ++mDropped;
+        return false;
+    }
+    
+    //Take the first free slot and point it to the end of the dense arrays
+    unsigned int index = mCount++;
+    unsigned int slot = TakeSlot( index );
+    
+    mPosX[index] = parachutist_.mPosX;
+    mPosY[index] = parachutist_.mPosY;
+    mPrevPosX[index] = parachutist_.mPrevPosX;
+    mPrevPosY[index] = parachutist_.mPrevPosY;
+    mVel[index] = parachutist_.mVel;
+    mWidth[index] = parachutist_.mWidth;
+    mHeight[index] = parachutist_.mHeight;
+    SetLegs( index );
+    mFlags[index] = 0;
+    
+    //Keep the bounds the broad phase query relies on
+    if( parachutist_.mVel > mMaxVel )
+    {
+        mMaxVel = parachutist_.mVel;
+    }
+    if( mHighWaterMark == 0 || parachutist_.mHeight < mMinHeight )
+    {
+        mMinHeight = parachutist_.mHeight;
+    }
+    if( parachutist_.mHeight > mMaxHeight )
+    {
+        mMaxHeight = parachutist_.mHeight;
+    }
+    
+    if( mCount > mHighWaterMark )
+    {
+        mHighWaterMark = mCount;
+    }
+    if( handle_ != NULL )
+    {
+        handle_->mSlot = slot;
+        handle_->mGeneration = mSlots[slot].mGeneration;
+    }
+    return true;
+}
+
+void ParachutistPool::SetLegs( unsigned int index )
+{
+    //The legs are the middle quarter of the sprite - rounded inwards so integer compares match the exact ranges
+    mLegLeft[index] = (int)ceil( mWidth[index] * 0.375 );
+    mLegRight[index] = (int)floor( mWidth[index] * 0.625 );
+}
+
+unsigned int ParachutistPool::TakeSlot( unsigned int index )
+{
+    unsigned int slot = mFreeSlot;
+    mFreeSlot = mSlots[slot].mIndex;
+    mSlots[slot].mIndex = index;
+    mSlotOf[index] = slot;
+    return(slot);
+}
+
+void ParachutistPool::RemoveAt( unsigned int index )
+{
+    unsigned int last = --mCount;
+    unsigned int slot = mSlotOf[index];
+    
+    //Move the last parachutist into the hole
+    if( index != last )
+    {
+        mPosX[index] = mPosX[last];
+        mPosY[index] = mPosY[last];
+        mPrevPosX[index] = mPrevPosX[last];
+        mPrevPosY[index] = mPrevPosY[last];
+        mVel[index] = mVel[last];
+        mWidth[index] = mWidth[last];
+        mHeight[index] = mHeight[last];
+        mLegLeft[index] = mLegLeft[last];
+        mLegRight[index] = mLegRight[last];
+        mFlags[index] = mFlags[last];
+        mSlotOf[index] = mSlotOf[last];
+        mSlots[mSlotOf[index]].mIndex = index;
+    }
+    
+    //Free the slot - handles to it become stale
+    ++mSlots[slot].mGeneration;
+    mSlots[slot].mIndex = mFreeSlot;
+    mFreeSlot = slot;
+}
+
+void ParachutistPool::Clear()
+{
+    while( mCount > 0 )
+    {
+        RemoveAt( mCount - 1 );
+    }
+}
+
+//Fields of a parachutist in a snapshot, each saved as one array
+static const unsigned int PARACHUTIST_STATE_FIELDS = 7;
+
+size_t ParachutistPool::GetStateSize() const
+{
+    return( (size_t)mCount * PARACHUTIST_STATE_FIELDS * sizeof(int) );
+}
+
+void ParachutistPool::SaveState( unsigned char *out_ ) const
+{
+    const std::vector<int> *fields[PARACHUTIST_STATE_FIELDS] = { &mPosX, &mPosY, &mPrevPosX, &mPrevPosY, &mVel, &mWidth, &mHeight };
+    size_t bytes = (size_t)mCount * sizeof(int);
+    for( unsigned int i = 0; i < PARACHUTIST_STATE_FIELDS && bytes > 0; ++i )
+    {
+        memcpy( out_ + i * bytes, fields[i]->data(), bytes );
+    }
+}
+
+void ParachutistPool::LoadState( const unsigned char *in_, unsigned int count )
+{
+    //Free the slots of the alive parachutists - handles to them become stale
+    for( unsigned int index = 0; index < mCount; ++index )
+    {
+        unsigned int slot = mSlotOf[index];
+        ++mSlots[slot].mGeneration;
+        mSlots[slot].mIndex = mFreeSlot;
+        mFreeSlot = slot;
+    }
+    
+    std::vector<int> *fields[PARACHUTIST_STATE_FIELDS] = { &mPosX, &mPosY, &mPrevPosX, &mPrevPosY, &mVel, &mWidth, &mHeight };
+    size_t bytes = (size_t)count * sizeof(int);
+    for( unsigned int i = 0; i < PARACHUTIST_STATE_FIELDS && bytes > 0; ++i )
+    {
+        memcpy( fields[i]->data(), in_ + i * bytes, bytes );
+    }
+    
+    mCount = count;
+    for( unsigned int index = 0; index < count; ++index )
+    {
+        TakeSlot( index );
+        mFlags[index] = 0;
+        
+        //Parachutists share a sprite - the legs only change with the width
+        if( index > 0 && mWidth[index] == mWidth[index - 1] )
+        {
+            mLegLeft[index] = mLegLeft[index - 1];
+            mLegRight[index] = mLegRight[index - 1];
+        }
+        else
+        {
+            SetLegs( index );
+        }
+        
+        //Keep the bounds the broad phase query relies on
+        mMaxVel = std::max( mMaxVel, mVel[index] );
+        mMinHeight = mHighWaterMark == 0 ? mHeight[index] : std::min( mMinHeight, mHeight[index] );
+        mMaxHeight = std::max( mMaxHeight, mHeight[index] );
+        mHighWaterMark = std::max( mHighWaterMark, index + 1 );
+    }
+}
+
+void ParachutistPool::SavePositions()
+{
+    if( mCount > 0 )
+    {
+        memcpy( &mPrevPosX[0], &mPosX[0], mCount * sizeof(int) );
+        memcpy( &mPrevPosY[0], &mPosY[0], mCount * sizeof(int) );
+    }
+}
+
+const int* ParachutistPool::Step( const Boat &boat_, bool simd_, SpatialGrid *grid_ )
+{
+    mLastNarrowTests = 0;
+    if( mCount == 0 )
+    {
+        return(NULL);
+    }
+    
+    //The boat floor is at 90% of the boat height - the kernel compares integers against its floor
+    BoatFloor floor;
+    floor.mFloorY = (int)::floor( boat_.GetPosY() + boat_.GetHeight() * 0.9 );
+    floor.mLeft = boat_.GetPosX();
+    floor.mRight = boat_.GetPosX() + boat_.GetWidth();
+    
+    ParachutistArrays arrays;
+    arrays.mPosX = &mPosX[0];
+    arrays.mPosY = &mPosY[0];
+    arrays.mVel = &mVel[0];
+    arrays.mHeight = &mHeight[0];
+    arrays.mLegLeft = &mLegLeft[0];
+    arrays.mLegRight = &mLegRight[0];
+    arrays.mFlags = &mFlags[0];
+    arrays.mCount = mCount;
+    
+    if( grid_ == NULL )
+    {
+        //Move and test everybody in one pass
+        if( simd_ )
+        {
+            StepParachutistsSimd( arrays, floor );
+        }
+        else
+        {
+            StepParachutistsScalar( arrays, floor );
+        }
+        mLastNarrowTests = mCount;
+        return(&mFlags[0]);
+    }
+    
+    //Broad phase: move everybody, then test only the parachutists whose feet can be within a step of the floor
+    if( simd_ )
+    {
+        MoveParachutistsSimd( arrays );
+    }
+    else
+    {
+        MoveParachutistsScalar( arrays );
+    }
+    grid_->Build( arrays.mPosX, arrays.mPosY, mCount );
+    
+    //Feet in (floor - vel, floor + vel] means the top in (floor - vel - height, floor + vel - height]
+    int top = floor.mFloorY - mMaxVel - mMaxHeight + 1;
+    int bottom = floor.mFloorY + mMaxVel - mMinHeight;
+    mCandidates.clear();
+    grid_->Query( 0, top, SCREEN_WIDTH, bottom - top + 1, mCandidates );
+    
+    if( !mCandidates.empty() )
+    {
+        TestParachutists( arrays, floor, &mCandidates[0], (unsigned int)mCandidates.size() );
+    }
+    mLastNarrowTests = (unsigned int)mCandidates.size();
+    return(&mFlags[0]);
+}
+
+unsigned int ParachutistPool::GetLastNarrowTests() const
+{
+    return(mLastNarrowTests);
+}
+
+unsigned int ParachutistPool::GetCount() const
+{
+    return(mCount);
+}
+
+Parachutist ParachutistPool::operator[]( unsigned int index ) const
+{
+    Parachutist parachutist(mSimPtr, mPosX[index]);
+    parachutist.mPosY = mPosY[index];
+    parachutist.mPrevPosX = mPrevPosX[index];
+    parachutist.mPrevPosY = mPrevPosY[index];
+    parachutist.mVel = mVel[index];
+    parachutist.mWidth = mWidth[index];
+    parachutist.mHeight = mHeight[index];
+    return(parachutist);
+}
+
+int ParachutistPool::GetPosX( unsigned int index ) const
+{
+    return(mPosX[index]);
+}
+
+int ParachutistPool::GetPosY( unsigned int index ) const
+{
+    return(mPosY[index]);
+}
+
+int ParachutistPool::GetVel( unsigned int index ) const
+{
+    return(mVel[index]);
+}
+
+int ParachutistPool::GetWidth( unsigned int index ) const
+{
+    return(mWidth[index]);
+}
+
+int ParachutistPool::GetHeight( unsigned int index ) const
+{
+    return(mHeight[index]);
+}
+
+void ParachutistPool::GetView( WorldView &view_ ) const
+{
+    view_.mParachutistCount = mCount;
+    view_.mParachutistPosX = mPosX.data();
+    view_.mParachutistPosY = mPosY.data();
+    view_.mParachutistVel = mVel.data();
+    view_.mParachutistWidth = mWidth.data();
+    view_.mParachutistHeight = mHeight.data();
+    view_.mParachutistLegLeft = mLegLeft.data();
+    view_.mParachutistLegRight = mLegRight.data();
+}
+
+void ParachutistPool::GetRenderState( RenderState &state_ ) const
+{
+    //Grow the arrays to the pool capacity once, instead of a little on every new high
+    if( state_.mParachutistPosX.size() < mCount )
+    {
+        state_.mParachutistPosX.resize( mPosX.size() );
+        state_.mParachutistPosY.resize( mPosX.size() );
+        state_.mParachutistPrevPosX.resize( mPosX.size() );
+        state_.mParachutistPrevPosY.resize( mPosX.size() );
+    }
+    state_.mParachutistCount = mCount;
+    std::copy( mPosX.begin(), mPosX.begin() + mCount, state_.mParachutistPosX.begin() );
+    std::copy( mPosY.begin(), mPosY.begin() + mCount, state_.mParachutistPosY.begin() );
+    std::copy( mPrevPosX.begin(), mPrevPosX.begin() + mCount, state_.mParachutistPrevPosX.begin() );
+    std::copy( mPrevPosY.begin(), mPrevPosY.begin() + mCount, state_.mParachutistPrevPosY.begin() );
+}
+
+ParachutistHandle ParachutistPool::GetHandle( unsigned int index ) const
+{
+    ParachutistHandle handle;
+    handle.mSlot = mSlotOf[index];
+    handle.mGeneration = mSlots[handle.mSlot].mGeneration;
+    return(handle);
+}
+
+bool ParachutistPool::Find( ParachutistHandle handle, unsigned int *index ) const
+{
+    if( handle.mSlot >= mSlots.size() || mSlots[handle.mSlot].mGeneration != handle.mGeneration )
+    {
+        return(false);
+    }
+    *index = mSlots[handle.mSlot].mIndex;
+    return(true);
+}
+
+unsigned int ParachutistPool::GetCapacity() const
+{
+    return((unsigned int)mSlots.size());
+}
+
+unsigned int ParachutistPool::GetHighWaterMark() const
+{
+    return(mHighWaterMark);
+}
+
+unsigned long ParachutistPool::GetDropped() const
+{
+    return(mDropped);
+}
+
+GameOver::GameOver(Simulation *mSimPtr_): AnimatedItem(mSimPtr_, SPRITE_GAMEOVER, SCREEN_WIDTH + 150,  (SCREEN_HEIGHT / 2) - 200 , 40, 0, 0, false)
+{}
+
+void GameOver::Move()
+{
+    
+    if(mPosX >= ((SCREEN_WIDTH / 2) - (GetWidth() / 2 ) + 25)) // Check if the gameover reach the center of the screen
+    {
+        //Move the gameover to the left
+        mPosX -= mVel;
+    }
+}
+
+void GameOver::Run()
+{
+    mAlive = true;
+}
+
+//Constructor for class Simulation
+Simulation::Simulation( const GameConfig &config_ ):
+                            mRandom(config_.mSeed),
+                            mParachutist(this, config_.mMaxParachutists),
+                            mScenario(config_.mScenario),
+                            mScore(0),
+                            mLife(INITIAL_LIFE),
+                            mTickCount(0),
+                            mBroadPhase(config_.mBroadPhase),
+                            mGrid(SCREEN_WIDTH, SCREEN_HEIGHT),
+                            mLastTestsAvoided(0),
+                            mTestsAvoided(0),
+                            mRecorder(NULL),
+                            mBoatCommand(0),
+                            mTelemetry(NULL)
+{
+    //Create the animated items
+    mBoat = new Boat(this);
+    for( unsigned int i = 0; i < mScenario.mAirplanes; ++i )
+    {
+        mAirplanes.push_back( new Airplane(this, mScenario, i, mScenario.mAirplanes) );
+    }
+    mGameOver = new GameOver(this);
+}
+
+Simulation::~Simulation()
+{
+    delete mBoat;
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        delete mAirplanes[i];
+    }
+    delete mGameOver;
+}
+
+void Simulation::Tick()
+{
+    //Keep the positions of the previous tick for interpolated rendering
+    mBoat->SavePosition();
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        mAirplanes[i]->SavePosition();
+    }
+    mGameOver->SavePosition();
+    mParachutist.SavePositions();
+    
+    //check if the game is over
+    if(mGameOver->IsAlive())
+    {
+        mGameOver->Move(); //display game over animation
+    }
+    else
+    {
+        Move(); //Move all game elements
+    }
+    ++mTickCount;
+}
+
+void Simulation::Move()
+{
+	//Move the animated items
+	mBoat->move();
+	for( size_t i = 0; i < mAirplanes.size(); ++i )
+	{
+		mAirplanes[i]->move();
+	}
+	
+	//Drop a wave of parachutists along the top of the screen
+	if( mScenario.mWaveInterval > 0 && mTickCount % mScenario.mWaveInterval == 0 )
+	{
+		for( unsigned int i = 0; i < mScenario.mWaveSize; ++i )
+		{
+			createParachutist( (int)mRandom.NextBelow( SCREEN_WIDTH ) );
+		}
+	}
+
+	//Move all parachutists that alive currently and test them against the boat floor in one batch
+	const int *flags = mParachutist.Step( *mBoat, true, mBroadPhase ? &mGrid : NULL );
+	mLastTestsAvoided = mParachutist.GetCount() - mParachutist.GetLastNarrowTests();
+	mTestsAvoided += mLastTestsAvoided;
+
+	//Go through the results from the end so the parachutist swapped into a removed index was already handled
+	for( unsigned int i = mParachutist.GetCount(); i-- > 0; )
+	{
+        if( ( flags[i] & PARACHUTIST_PASSED ) && !mScenario.mEndless ) // check if Parachutist passed the boat (endless games lose no life)
+        {
+
+            if (mLife == 0)
+            {
+                if( mTelemetry != NULL && !mGameOver->IsAlive() )
+                {
+                    mTelemetry->Record( TELEMETRY_GAME_OVER, mTickCount, (int32_t)mScore );
+                }
+                mGameOver->Run();
+            }
+            else
+            {
+                mLife -= 1;
+                if( mTelemetry != NULL )
+                {
+                    mTelemetry->Record( TELEMETRY_LIFE_LOST, mTickCount, mLife, mParachutist.GetPosX( i ) );
+                }
+            }
+        }
+        
+        // remove Parachutist from the pool if the parachutist pass the bottom of the screen or touch the boat
+		if( flags[i] & PARACHUTIST_OUT ) // check if Parachutist passed the bottom of the screen
+		{
+			mParachutist.RemoveAt(i);
+		}
+		else if( flags[i] & PARACHUTIST_CAUGHT )
+		{
+			if( mTelemetry != NULL )
+			{
+				mTelemetry->Record( TELEMETRY_SCORE, mTickCount, (int32_t)mScore + 10, mParachutist.GetPosX( i ) );
+			}
+			mParachutist.RemoveAt(i);
+			mScore += 10;
+		}
+	}
+}
+
+void Simulation::KeyDown( BoatKey key )
+{
+    if( mRecorder != NULL )
+    {
+        mRecorder->Record( mTickCount, key, true );
+    }
+    mBoat->KeyDown( key );
+}
+
+void Simulation::KeyUp( BoatKey key )
+{
+    if( mRecorder != NULL )
+    {
+        mRecorder->Record( mTickCount, key, false );
+    }
+    mBoat->KeyUp( key );
+}
+
+void Simulation::SetBoatCommand( int command )
+{
+    //Release the held key and press the new one only when the command changes
+    if( command != mBoatCommand )
+    {
+        if( mBoatCommand != 0 )
+        {
+            KeyUp( mBoatCommand < 0 ? BOAT_KEY_LEFT : BOAT_KEY_RIGHT );
+        }
+        if( command != 0 )
+        {
+            KeyDown( command < 0 ? BOAT_KEY_LEFT : BOAT_KEY_RIGHT );
+        }
+        mBoatCommand = command;
+    }
+}
+
+void Simulation::SetInputRecorder( InputRecorder *recorder_ )
+{
+    mRecorder = recorder_;
+}
+
+void Simulation::SetTelemetry( Telemetry *telemetry_ )
+{
+    mTelemetry = telemetry_;
+}
+
+//FNV-1a over the values that make up the game state
+static void HashValue( uint64_t &hash, int64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+    {
+        hash ^= (uint64_t)( value >> ( 8 * i ) ) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void HashItem( uint64_t &hash, const AnimatedItem &item )
+{
+    HashValue( hash, item.GetPosX() );
+    HashValue( hash, item.GetPosY() );
+    HashValue( hash, item.IsAlive() );
+}
+
+uint64_t Simulation::GetStateHash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    HashValue( hash, mTickCount );
+    HashValue( hash, mScore );
+    HashValue( hash, mLife );
+    HashItem( hash, *mBoat );
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        HashItem( hash, *mAirplanes[i] );
+    }
+    HashItem( hash, *mGameOver );
+    HashValue( hash, mParachutist.GetCount() );
+    for( unsigned int i = 0; i < mParachutist.GetCount(); ++i )
+    {
+        HashValue( hash, mParachutist.GetPosX( i ) );
+        HashValue( hash, mParachutist.GetPosY( i ) );
+    }
+    return(hash);
+}
+
+static const char SNAPSHOT_MAGIC[4] = { 'P', 'S', 'N', 'P' };
+static const uint32_t SNAPSHOT_VERSION = 3;
+
+size_t Simulation::GetSnapshotCapacity() const
+{
+    return sizeof(SnapshotHeader) + mAirplanes.size() * sizeof(AirplaneState) +
+           (size_t)mParachutist.GetCapacity() * PARACHUTIST_STATE_FIELDS * sizeof(int);
+}
+
+size_t Simulation::GetSnapshotSize() const
+{
+    return sizeof(SnapshotHeader) + mAirplanes.size() * sizeof(AirplaneState) + mParachutist.GetStateSize();
+}
+
+size_t Simulation::SaveSnapshot( void *buffer_, size_t size ) const
+{
+    size_t snapshotSize = GetSnapshotSize();
+    if( size < snapshotSize )
+    {
+        return 0;
+    }
+    
+    //Zeroed first so the padding bytes are too - snapshots of the same state are byte identical
+    SnapshotHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.mMagic, SNAPSHOT_MAGIC, sizeof(header.mMagic) );
+    header.mVersion = SNAPSHOT_VERSION;
+    header.mSize = (uint32_t)snapshotSize;
+    header.mAirplaneCount = (uint32_t)mAirplanes.size();
+    header.mParachutistCount = mParachutist.GetCount();
+    header.mTickCount = mTickCount;
+    mRandom.GetState( &header.mRandomState, &header.mRandomIncrement );
+    header.mTestsAvoided = mTestsAvoided;
+    header.mScore = (int32_t)mScore;
+    header.mLife = mLife;
+    header.mBoatCommand = mBoatCommand;
+    header.mBoat = mBoat->GetState();
+    header.mGameOver = mGameOver->GetState();
+    header.mJumpsPerPass = mScenario.mJumpsPerPass;
+    header.mAirplaneVel = mScenario.mAirplaneVel;
+    header.mMinFallVel = mScenario.mMinFallVel;
+    header.mMaxFallVel = mScenario.mMaxFallVel;
+    header.mWaveInterval = mScenario.mWaveInterval;
+    header.mWaveSize = mScenario.mWaveSize;
+    header.mEndless = mScenario.mEndless ? 1 : 0;
+    
+    unsigned char *out = (unsigned char *)buffer_;
+    memcpy( out, &header, sizeof(header) );
+    out += sizeof(header);
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        AirplaneState airplane = mAirplanes[i]->GetAirplaneState();
+        memcpy( out, &airplane, sizeof(airplane) );
+        out += sizeof(airplane);
+    }
+    mParachutist.SaveState( out );
+    return snapshotSize;
+}
+
+bool Simulation::LoadSnapshot( const void *buffer_, size_t size )
+{
+    SnapshotHeader header;
+    if( size < sizeof(header) )
+    {
+        return false;
+    }
+    memcpy( &header, buffer_, sizeof(header) );
+    if( memcmp( header.mMagic, SNAPSHOT_MAGIC, sizeof(header.mMagic) ) != 0 || header.mVersion != SNAPSHOT_VERSION ||
+        header.mAirplaneCount != mAirplanes.size() || header.mParachutistCount > mParachutist.GetCapacity() ||
+        header.mSize != sizeof(header) + mAirplanes.size() * sizeof(AirplaneState) +
+                        (size_t)header.mParachutistCount * PARACHUTIST_STATE_FIELDS * sizeof(int) || header.mSize > size )
+    {
+        return false;
+    }
+    
+    //A snapshot of another scenario would play on under the wrong rules
+    if( header.mJumpsPerPass != mScenario.mJumpsPerPass || header.mAirplaneVel != mScenario.mAirplaneVel ||
+        header.mMinFallVel != mScenario.mMinFallVel || header.mMaxFallVel != mScenario.mMaxFallVel ||
+        header.mWaveInterval != mScenario.mWaveInterval || header.mWaveSize != mScenario.mWaveSize ||
+        header.mEndless != ( mScenario.mEndless ? 1u : 0u ) )
+    {
+        return false;
+    }
+    
+    mTickCount = header.mTickCount;
+    mRandom.SetState( header.mRandomState, header.mRandomIncrement );
+    mTestsAvoided = header.mTestsAvoided;
+    mScore = (unsigned int)header.mScore;
+    mLife = header.mLife;
+    mBoatCommand = header.mBoatCommand;
+    mBoat->SetState( header.mBoat );
+    mGameOver->SetState( header.mGameOver );
+    
+    const unsigned char *in = (const unsigned char *)buffer_ + sizeof(header);
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        AirplaneState airplane;
+        memcpy( &airplane, in, sizeof(airplane) );
+        mAirplanes[i]->SetAirplaneState( airplane );
+        in += sizeof(airplane);
+    }
+    mParachutist.LoadState( in, header.mParachutistCount );
+    return true;
+}
+
+void Simulation::createParachutist(int PosX_)
+{
+	//Draw a fall speed only when the scenario has a range (the original game keeps its random sequence)
+	int vel = mScenario.mMinFallVel;
+	if( mScenario.mMaxFallVel > mScenario.mMinFallVel )
+	{
+		vel += (int)mRandom.NextBelow( (uint32_t)( mScenario.mMaxFallVel - mScenario.mMinFallVel + 1 ) );
+	}
+	
+	if( mParachutist.Add(Parachutist(this, PosX_, vel)) && mTelemetry != NULL )
+	{
+		mTelemetry->Record( TELEMETRY_SPAWN, mTickCount, PosX_, (int32_t)mParachutist.GetCount() );
+	}
+}
+
+Boat& Simulation::GetBoat()
+{
+    return(*mBoat);
+}
+
+const Boat& Simulation::GetBoat() const
+{
+    return(*mBoat);
+}
+
+unsigned int Simulation::GetAirplaneCount() const
+{
+    return (unsigned int)mAirplanes.size();
+}
+
+const Airplane& Simulation::GetAirplane( unsigned int index ) const
+{
+    return(*mAirplanes[index]);
+}
+
+const GameOver& Simulation::GetGameOver() const
+{
+    return(*mGameOver);
+}
+
+ParachutistPool& Simulation::GetParachutists()
+{
+    return(mParachutist);
+}
+
+const ParachutistPool& Simulation::GetParachutists() const
+{
+    return(mParachutist);
+}
+
+WorldView Simulation::GetWorldView() const
+{
+    WorldView view;
+    view.mTick = mTickCount;
+    view.mBoatPosX = mBoat->GetPosX();
+    view.mBoatPosY = mBoat->GetPosY();
+    view.mBoatWidth = mBoat->GetWidth();
+    view.mBoatHeight = mBoat->GetHeight();
+    view.mBoatVel = mBoat->GetVel();
+    view.mBoatVelX = mBoat->GetVelX();
+    view.mBoatFloorY = (int)::floor( mBoat->GetPosY() + mBoat->GetHeight() * 0.9 ); // same floor as ParachutistPool::Step
+    mParachutist.GetView( view );
+    return(view);
+}
+
+void Simulation::GetRenderState( RenderState &state_ ) const
+{
+    state_.mTick = mTickCount;
+    state_.mScore = mScore;
+    state_.mLife = mLife;
+    state_.mBoat = mBoat->GetState();
+    state_.mGameOver = mGameOver->GetState();
+    state_.mAirplanes.resize( mAirplanes.size() );
+    for( size_t i = 0; i < mAirplanes.size(); ++i )
+    {
+        state_.mAirplanes[i] = mAirplanes[i]->GetState();
+    }
+    mParachutist.GetRenderState( state_ );
+}
+
+unsigned int Simulation::GetScore() const
+{
+    return(mScore);
+}
+
+int Simulation::GetLife() const
+{
+    return(mLife);
+}
+
+bool Simulation::IsGameOver() const
+{
+    return(mGameOver->IsAlive());
+}
+
+unsigned long Simulation::GetTickCount() const
+{
+    return(mTickCount);
+}
+
+unsigned int Simulation::GetLastTestsAvoided() const
+{
+    return(mLastTestsAvoided);
+}
+
+unsigned long Simulation::GetTestsAvoided() const
+{
+    return(mTestsAvoided);
+}
@@ -0,0 +1,442 @@
+//
+//  simulation.hpp
+//  Game
+//
+//  The game logic: animated items, collision and scoring.
+//  Nothing here depends on SDL so the simulation can run without a window.
+//
+
+#ifndef simulation_h
+#define simulation_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "config.hpp"
+#include "grid.hpp"
+#include "random.hpp"
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 1040;
+const int SCREEN_HEIGHT = 680;
+
+//forward declaration of all classes
+class Simulation;
+class AnimatedItem;
+class Boat;
+class Airplane;
+class Parachutist;
+class ParachutistPool;
+class GameOver;
+class InputRecorder;
+class Telemetry;
+struct WorldView;
+struct RenderState;
+
+//The sprites of the game
+enum SpriteId
+{
+    SPRITE_BOAT,
+    SPRITE_AIRPLANE,
+    SPRITE_PARACHUTIST,
+    SPRITE_GAMEOVER,
+    SPRITE_COUNT
+};
+
+//Asset metadata of a sprite - the simulation uses the dimensions without loading the image
+struct SpriteInfo
+{
+    const char *mPath; //image file of the sprite
+    int mWidth; //image width
+    int mHeight; //image height
+};
+
+//Metadata of every sprite (indexed by SpriteId)
+extern const SpriteInfo SPRITES[SPRITE_COUNT];
+
+//Fall speed of a parachutist of the original game
+const int PARACHUTIST_VEL = 4;
+//Lives at the start of a game
+const int INITIAL_LIFE = 3;
+
+//Keys that drive the boat
+enum BoatKey
+{
+    BOAT_KEY_LEFT,
+    BOAT_KEY_RIGHT
+};
+
+//Saved state of an animated item (part of a game snapshot)
+struct ItemState
+{
+    int32_t mPosX, mPosY;
+    int32_t mPrevPosX, mPrevPosY;
+    int32_t mVelX, mVelY;
+    int32_t mAlive;
+};
+
+//Saved state of an airplane (part of a game snapshot)
+struct AirplaneState
+{
+    ItemState mItem;
+    int32_t mJumpXPos; //next jump
+    int32_t mJumpsLeft; //jumps left in the current pass
+};
+
+class AnimatedItem
+{
+public:
+    //Constructor: Initializes the variables
+    AnimatedItem(Simulation *mSimPtr_, SpriteId Sprite_, int PosX_, int PosY_, int Vel_ = 10, int VelX_ = 0, int VelY_ = 0, bool Alive_ = true);
+    //Remembers the current position as the previous tick position (called before each tick)
+    void SavePosition();
+    //return position Y of animated item
+    int GetPosY() const;
+    //return position X of animated item
+    int GetPosX() const;
+    //return position Y of animated item on the previous tick
+    int GetPrevPosY() const;
+    //return position X of animated item on the previous tick
+    int GetPrevPosX() const;
+    //return velocity of animated item
+    int GetVel() const;
+    //return the current X velocity of animated item
+    int GetVelX() const;
+    //return width of animated item
+    int GetWidth() const;
+    //return height of animated item
+    int GetHeight() const;
+    //return the sprite the item is drawn with
+    SpriteId GetSprite() const;
+    //check is Item is alive (for parachutists and gameover)
+    bool IsAlive() const;
+    //Saves and restores the item's motion (a game snapshot)
+    ItemState GetState() const;
+    void SetState( const ItemState &state_ );
+    
+    
+protected:
+    Simulation *mSimPtr; // pointer to the simulation the item belongs to
+    SpriteId mSprite; // Item's sprite
+    int mWidth, mHeight; // Item's dimensions (from the sprite metadata)
+    int mPosX, mPosY; //The X and Y offsets of the item
+    int mPrevPosX, mPrevPosY; //The X and Y offsets on the previous tick (for interpolated rendering)
+    int mVel; //Maximum axis velocity of the Item
+    int mVelX, mVelY; 	//The velocity of the item by axis
+    bool mAlive = true; // set if the item is visiable and active (for parachutist and gameover)
+};
+
+class Boat: public AnimatedItem
+{
+public:
+    //Constructor: Initializes the variables
+    Boat(Simulation *mSimPtr_);
+    //Adjusts the Boat's velocity when a key is pressed
+    void KeyDown( BoatKey key );
+    //Adjusts the Boat's velocity when a key is released
+    void KeyUp( BoatKey key );
+    //Moves the item
+    void move();
+};
+
+class Airplane: public AnimatedItem
+{
+public:
+    //Constructor: Initializes the variables (airplanes of a scenario start index_ / count_ of the way apart)
+    Airplane(Simulation *mSimPtr_, const Scenario &scenario_, unsigned int index_ = 0, unsigned int count_ = 1);
+    //Moves the airplane
+    void move();
+    //Saves and restores the airplane (a game snapshot)
+    AirplaneState GetAirplaneState() const;
+    void SetAirplaneState( const AirplaneState &state_ );
+    
+private:
+    //Draws the next jump point of a pass so the airplane reaches it and the jumps left after it - false if they do not fit
+    bool DrawJumpXPos();
+    
+    int mJumpXPos; // X Position of the parashutist jump
+    unsigned int mJumpsPerPass; // parachutists dropped per pass over the screen
+    unsigned int mJumpsLeft; // parachutists still to drop in this pass
+    
+};
+
+class Parachutist: public AnimatedItem
+{
+public:
+    //Constructor: Initializes the variables
+    Parachutist(Simulation *mSimPtr_, int PosX_, int Vel_ = PARACHUTIST_VEL);
+    //Check if the Parachusist is out of the screen
+    static bool IsOutOfRange(const Parachutist *parachutist_);
+    
+private:
+    friend class ParachutistPool; // the pool stores the parachutist fields as arrays
+};
+
+//Handle to a parachutist in the pool - it becomes stale once the parachutist is removed
+struct ParachutistHandle
+{
+    unsigned int mSlot; //slot of the parachutist
+    unsigned int mGeneration; //generation of the slot when the handle was made
+};
+
+//Fixed capacity slot map that keeps the alive parachutists contiguous in memory,
+//every field is stored in its own array so a tick runs as one batch kernel (see kernel.hpp)
+class ParachutistPool
+{
+public:
+    //Constructor: allocates the storage for capacity_ parachutists (the only allocation the pool does)
+    ParachutistPool(Simulation *mSimPtr_, unsigned int capacity_);
+    
+    //Adds a parachutist - returns false (and counts the drop) when the pool is full
+    bool Add( const Parachutist &parachutist_, ParachutistHandle *handle_ = NULL );
+    //Removes the parachutist at index, the last parachutist takes its place (O(1))
+    void RemoveAt( unsigned int index );
+    //Removes all parachutists
+    void Clear();
+    
+    //Snapshot of the parachutists: bytes SaveState writes for the alive parachutists
+    size_t GetStateSize() const;
+    //Copies the parachutist fields to out_ (GetStateSize bytes)
+    void SaveState( unsigned char *out_ ) const;
+    //Replaces the parachutists by count saved ones - handles made before become stale
+    void LoadState( const unsigned char *in_, unsigned int count );
+    
+    //Remembers the current positions as the previous tick positions
+    void SavePositions();
+    //Moves all parachutists one tick and tests them against the boat floor, returns the kernel flags per index.
+    //With a grid only the parachutists the grid finds near the boat floor are tested.
+    const int *Step( const Boat &boat_, bool simd_ = true, SpatialGrid *grid_ = NULL );
+    //Number of boat floor tests the last Step ran
+    unsigned int GetLastNarrowTests() const;
+    
+    //Access to the alive parachutists by dense index (0..GetCount()-1)
+    unsigned int GetCount() const;
+    Parachutist operator[]( unsigned int index ) const;
+    int GetPosX( unsigned int index ) const;
+    int GetPosY( unsigned int index ) const;
+    int GetVel( unsigned int index ) const;
+    int GetWidth( unsigned int index ) const;
+    int GetHeight( unsigned int index ) const;
+    
+    //Points the parachutist fields of a world view to the pool arrays (valid until the next change of the pool)
+    void GetView( WorldView &view_ ) const;
+    //Copies the parachutist positions of the last two ticks to a render state
+    void GetRenderState( RenderState &state_ ) const;
+    
+    //Handle of the parachutist at index
+    ParachutistHandle GetHandle( unsigned int index ) const;
+    //Finds the index of the parachutist of a handle - returns false if it was removed
+    bool Find( ParachutistHandle handle, unsigned int *index ) const;
+    
+    //Pool statistics
+    unsigned int GetCapacity() const;
+    unsigned int GetHighWaterMark() const; //most parachutists alive at the same time
+    unsigned long GetDropped() const; //parachutists not created because the pool was full
+    
+private:
+    
+    //A slot a handle points to
+    struct Slot
+    {
+        unsigned int mIndex; //dense index of the parachutist (next free slot while the slot is free)
+        unsigned int mGeneration; //incremented every time the slot is freed
+    };
+    
+    Simulation *mSimPtr; // simulation the parachutists belong to
+    unsigned int mCount; //number of alive parachutists
+    
+    //The alive parachutists, one array per field (dense index)
+    std::vector<int> mPosX, mPosY; //X and Y offsets
+    std::vector<int> mPrevPosX, mPrevPosY; //X and Y offsets on the previous tick
+    std::vector<int> mVel; //velocity
+    std::vector<int> mWidth, mHeight; //dimensions
+    std::vector<int> mLegLeft, mLegRight; //X offsets of the legs (range that lands on the boat)
+    std::vector<int> mFlags; //kernel results of the last Step
+    
+    //Bounds over all parachutists ever added (the broad phase query grows by them)
+    int mMaxVel; //largest downwards velocity
+    int mMinHeight, mMaxHeight; //smallest and largest height
+    std::vector<unsigned int> mCandidates; //parachutists the broad phase found near the boat floor
+    unsigned int mLastNarrowTests; //boat floor tests run by the last Step
+    
+    //Sets the legs of the parachutist at index from its width
+    void SetLegs( unsigned int index );
+    //Gives the parachutist at index a free slot
+    unsigned int TakeSlot( unsigned int index );
+    
+    std::vector<unsigned int> mSlotOf; //slot of each dense index
+    std::vector<Slot> mSlots; //slots by handle
+    unsigned int mFreeSlot; //first free slot
+    unsigned int mHighWaterMark;
+    unsigned long mDropped;
+};
+
+//Read-only view of the world state a boat controller decides on (see controller.hpp).
+//Every tick a parachutist moves by ( -vel / 4, vel ) and the boat by its X velocity.
+struct WorldView
+{
+    unsigned long mTick; //ticks simulated so far
+    
+    //The boat
+    int mBoatPosX, mBoatPosY; //offsets
+    int mBoatWidth, mBoatHeight; //dimensions
+    int mBoatVel; //speed the boat moves at while a key is held
+    int mBoatVelX; //current X velocity
+    int mBoatFloorY; //Y offset the parachutist feet land on
+    
+    //The alive parachutists, one array per field (mParachutistCount entries each)
+    unsigned int mParachutistCount;
+    const int *mParachutistPosX, *mParachutistPosY; //offsets
+    const int *mParachutistVel; //velocities
+    const int *mParachutistWidth, *mParachutistHeight; //dimensions
+    const int *mParachutistLegLeft, *mParachutistLegRight; //X offsets of the legs (the part that lands on the boat)
+};
+
+//What a frame draws: the positions of the last two ticks and the HUD values, copied out of the simulation
+//so a render thread can draw them while the simulation thread runs the next ticks
+struct RenderState
+{
+    unsigned long mTick; //ticks simulated so far
+    unsigned int mScore;
+    int mLife;
+    ItemState mBoat, mGameOver;
+    std::vector<ItemState> mAirplanes;
+    
+    //The alive parachutists, one array per field (mParachutistCount entries each - the arrays only grow)
+    unsigned int mParachutistCount;
+    std::vector<int> mParachutistPosX, mParachutistPosY;
+    std::vector<int> mParachutistPrevPosX, mParachutistPrevPosY;
+};
+
+class GameOver: public AnimatedItem
+{
+public:
+    //Constructor: Initializes the variables
+    GameOver(Simulation *mSimPtr_);
+    //Moves the airplane
+    void Move();
+    void Run();
+};
+
+//Fixed part of a game snapshot, followed by the airplanes (AirplaneState each) and the parachutist fields (see ParachutistPool::SaveState).
+//Snapshots are for the machine that took them (native byte order).
+struct SnapshotHeader
+{
+    char mMagic[4]; //"PSNP"
+    uint32_t mVersion;
+    uint32_t mSize; //bytes of the whole snapshot
+    uint32_t mAirplaneCount;
+    uint32_t mParachutistCount;
+    uint64_t mTickCount;
+    uint64_t mRandomState, mRandomIncrement; //generator of the jump points
+    uint64_t mTestsAvoided;
+    int32_t mScore;
+    int32_t mLife;
+    int32_t mBoatCommand; //key the boat commands hold
+    ItemState mBoat, mGameOver;
+    
+    //Rules of the scenario the snapshot was taken under (its airplanes are mAirplaneCount) - a snapshot
+    //only loads into a simulation of the same scenario
+    uint32_t mJumpsPerPass;
+    int32_t mAirplaneVel;
+    int32_t mMinFallVel, mMaxFallVel;
+    uint32_t mWaveInterval, mWaveSize;
+    uint32_t mEndless;
+};
+
+//Holds all animated items and runs the game rules
+class Simulation
+{
+public:
+    //Constructor: Initializes the variables
+    Simulation( const GameConfig &config_ = GameConfig() );
+    //Destructor: release all of the animated items
+    ~Simulation();
+    // Advance the game by one tick
+    void Tick();
+    //Moves all animated object and check parachutist location and kill it if needed
+    void Move();
+    
+    //Presses and releases the boat keys before the coming tick (recorded when an input recorder is set)
+    void KeyDown( BoatKey key );
+    void KeyUp( BoatKey key );
+    //Sets the boat velocity for the coming tick (-1 left, 0 stop, 1 right) by pressing and releasing the keys
+    void SetBoatCommand( int command );
+    //Records the key transitions to an input log (NULL stops recording)
+    void SetInputRecorder( InputRecorder *recorder_ );
+    //Records the score, life and spawn events to the live telemetry (NULL stops recording)
+    void SetTelemetry( Telemetry *telemetry_ );
+    
+    //Animated items (for rendering and input)
+    Boat &GetBoat();
+    const Boat &GetBoat() const;
+    unsigned int GetAirplaneCount() const;
+    const Airplane &GetAirplane( unsigned int index ) const;
+    const GameOver &GetGameOver() const;
+    ParachutistPool &GetParachutists();
+    const ParachutistPool &GetParachutists() const;
+    //Read-only view of the world state (valid until the next tick)
+    WorldView GetWorldView() const;
+    //Copies what a frame draws to state_ (allocates only when the parachutists outgrow the state's arrays)
+    void GetRenderState( RenderState &state_ ) const;
+    
+    //Score members
+    unsigned int GetScore() const;
+    int GetLife() const;
+    //check if the game is over
+    bool IsGameOver() const;
+    //return how many ticks were simulated
+    unsigned long GetTickCount() const;
+    //return how many boat floor tests the broad phase avoided on the last tick and in total
+    unsigned int GetLastTestsAvoided() const;
+    unsigned long GetTestsAvoided() const;
+    //Hash of the whole game state - equal hashes after the same ticks mean a replay matched its recording
+    uint64_t GetStateHash() const;
+    
+    //Snapshots: the whole game state in a flat buffer, taken and restored without allocating (cheap enough for every tick)
+    size_t GetSnapshotCapacity() const; //largest snapshot of the simulation (a full parachutist pool)
+    size_t GetSnapshotSize() const; //size of a snapshot of the current state
+    //Writes the state to buffer_ - returns the bytes written, 0 if the buffer is too small
+    size_t SaveSnapshot( void *buffer_, size_t size ) const;
+    //Restores a state written by SaveSnapshot - returns false (and keeps the state) if the buffer
+    //is not a snapshot, was taken under another scenario or does not fit the parachutist pool
+    bool LoadSnapshot( const void *buffer_, size_t size );
+    
+private:
+    
+    Simulation( const Simulation &other_); //disable copy constructor
+    
+    //Random numbers of the game - must be declared before the animated items that use it
+    Random mRandom;
+    
+    //AnimatedItems
+    Boat *mBoat; // pointer to a boat
+    friend Airplane;
+    std::vector<Airplane *> mAirplanes; //the airplanes of the scenario
+    ParachutistPool mParachutist; //pool to hold the possible multiple instances of parachutist
+    GameOver *mGameOver; //animation for gameover;
+    
+    Scenario mScenario; //airplanes and waves of the game
+    
+    //Score members
+    unsigned int mScore; //keeps the game score
+    int mLife; //keeps how many lives have left in the game
+    
+    unsigned long mTickCount; //simulation ticks run
+    
+    //Broad phase
+    bool mBroadPhase; //test only the parachutists near the boat floor
+    SpatialGrid mGrid; //grid of the parachutists over the play field
+    unsigned int mLastTestsAvoided; //boat floor tests skipped on the last tick
+    unsigned long mTestsAvoided; //boat floor tests skipped since the start
+    
+    InputRecorder *mRecorder; //records the key transitions (not owned, NULL when not recording)
+    int mBoatCommand; //last boat command (the key SetBoatCommand holds)
+    Telemetry *mTelemetry; //live telemetry of the game events (not owned, NULL when off)
+    
+    //Methods
+    void createParachutist(int PosX_); // create a new Parachutist with a fall speed from the scenario range
+};
+
+#endif /* simulation_h */
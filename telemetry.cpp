@@ -0,0 +1,302 @@
+//
+//  telemetry.cpp
+//  Game
+//
+
+#include <string.h>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "telemetry.hpp"
+
+static const char TELEMETRY_MAGIC[4] = { 'P', 'T', 'L', 'M' };
+static const uint32_t TELEMETRY_VERSION = 1;
+
+//Names of the record types and their values in the JSON lines (indexed by TelemetryType)
+static const char *const TELEMETRY_NAMES[TELEMETRY_TYPE_COUNT] = { "frame", "tick", "score", "life_lost", "spawn", "game_over" };
+static const char *const TELEMETRY_VALUE_NAMES[TELEMETRY_TYPE_COUNT][3] =
+{
+    { "frame_us", "ticks", "parachutists" },
+    { "tick_ns", "parachutists", NULL },
+    { "score", "x", NULL },
+    { "life", "x", NULL },
+    { "x", "parachutists", NULL },
+    { "score", NULL, NULL }
+};
+
+TelemetryRing::TelemetryRing( unsigned int capacity_ ): mHead(0), mTail(0), mDropped(0)
+{
+    uint64_t capacity = 1;
+    while( capacity < capacity_ )
+    {
+        capacity <<= 1;
+    }
+    mRecords.resize( (size_t)capacity );
+    mMask = capacity - 1;
+}
+
+bool TelemetryRing::Push( const TelemetryRecord &record_ )
+{
+    //Only this thread writes the head - the tail is read with acquire so the slot is free once it is seen
+    uint64_t head = mHead.load( std::memory_order_relaxed );
+    if( head - mTail.load( std::memory_order_acquire ) > mMask )
+    {
+        mDropped.store( mDropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        return false;
+    }
+    mRecords[(size_t)( head & mMask )] = record_;
+    mHead.store( head + 1, std::memory_order_release ); // publishes the record
+    return true;
+}
+
+bool TelemetryRing::Pop( TelemetryRecord &record_ )
+{
+    uint64_t tail = mTail.load( std::memory_order_relaxed );
+    if( tail == mHead.load( std::memory_order_acquire ) )
+    {
+        return false;
+    }
+    record_ = mRecords[(size_t)( tail & mMask )];
+    mTail.store( tail + 1, std::memory_order_release ); // gives the slot back to the producer
+    return true;
+}
+
+unsigned long TelemetryRing::GetDropped() const
+{
+    return(mDropped.load( std::memory_order_relaxed ));
+}
+
+Telemetry::Telemetry( const char *target_, TelemetryFormat format_ ): mFormat(format_),
+                                                                        mFile(NULL),
+                                                                        mSocket(-1),
+                                                                        mFailed(false),
+                                                                        mStart(std::chrono::steady_clock::now()),
+                                                                        mStop(false),
+                                                                        mWritten(0),
+                                                                        mLost(0)
+{
+    std::string errormsg;
+    
+    if( strncmp( target_, TELEMETRY_SOCKET_PREFIX, strlen( TELEMETRY_SOCKET_PREFIX ) ) == 0 )
+    {
+#ifdef _WIN32
+        throw std::runtime_error("Telemetry sockets are not supported on this platform!\n");
+#else
+        //Connect to a listening Unix domain stream socket
+        const char *path = target_ + strlen( TELEMETRY_SOCKET_PREFIX );
+        struct sockaddr_un address;
+        memset( &address, 0, sizeof(address) );
+        address.sun_family = AF_UNIX;
+        if( strlen( path ) >= sizeof(address.sun_path) )
+        {
+            throw std::runtime_error("Telemetry socket path is too long!\n");
+        }
+        strcpy( address.sun_path, path );
+        
+        mSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+        if( mSocket < 0 || connect( mSocket, (struct sockaddr *)&address, sizeof(address) ) != 0 )
+        {
+            if( mSocket >= 0 )
+            {
+                close( mSocket );
+            }
+            errormsg = "Unable to connect to the telemetry socket ";
+            errormsg.append( path );
+            throw std::runtime_error(errormsg.c_str());
+        }
+#endif
+    }
+    else
+    {
+        mFile = fopen( target_, mFormat == TELEMETRY_BINARY ? "wb" : "w" );
+        if( mFile == NULL )
+        {
+            errormsg = "Unable to open the telemetry file ";
+            errormsg.append( target_ );
+            throw std::runtime_error(errormsg.c_str());
+        }
+    }
+    
+    if( mFormat == TELEMETRY_BINARY )
+    {
+        TelemetryHeader header;
+        memcpy( header.mMagic, TELEMETRY_MAGIC, sizeof(header.mMagic) );
+        header.mVersion = TELEMETRY_VERSION;
+        header.mRecordSize = sizeof(TelemetryRecord);
+        header.mReserved = 0;
+        mFailed = !Write( &header, sizeof(header) );
+    }
+    
+    mThread = std::thread( &Telemetry::Drain, this );
+}
+
+Telemetry::~Telemetry()
+{
+    Close();
+}
+
+void Telemetry::Close()
+{
+    if( !mThread.joinable() )
+    {
+        return;
+    }
+    mStop.store( true );
+    mThread.join();
+    
+    if( mFile != NULL )
+    {
+        fclose( mFile );
+        mFile = NULL;
+    }
+#ifndef _WIN32
+    if( mSocket >= 0 )
+    {
+        close( mSocket );
+        mSocket = -1;
+    }
+#endif
+}
+
+void Telemetry::Record( TelemetryType type, uint64_t tick, int32_t value0, int32_t value1, int32_t value2 )
+{
+    TelemetryRecord record;
+    record.mTime = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - mStart ).count();
+    record.mTick = tick;
+    record.mType = type;
+    record.mValue[0] = value0;
+    record.mValue[1] = value1;
+    record.mValue[2] = value2;
+    mRing.Push( record );
+}
+
+void Telemetry::Drain()
+{
+    //Records are exported in chunks - one write per chunk instead of one per record
+    const unsigned int chunkRecords = 256;
+    std::string chunk;
+    TelemetryRecord record;
+    
+    for( ;; )
+    {
+        //Read the stop flag before draining so the records pushed before the stop are exported
+        bool stop = mStop.load();
+        unsigned long count = 0;
+        
+        while( mRing.Pop( record ) )
+        {
+            if( mFormat == TELEMETRY_BINARY )
+            {
+                chunk.append( (const char *)&record, sizeof(record) );
+            }
+            else
+            {
+                char line[256];
+                int length = snprintf( line, sizeof(line), "{\"t_us\":%llu,\"tick\":%llu,\"type\":\"%s\"", (unsigned long long)record.mTime,
+                                       (unsigned long long)record.mTick, record.mType < TELEMETRY_TYPE_COUNT ? TELEMETRY_NAMES[record.mType] : "unknown" );
+                for( int i = 0; i < 3 && record.mType < TELEMETRY_TYPE_COUNT && TELEMETRY_VALUE_NAMES[record.mType][i] != NULL; ++i )
+                {
+                    length += snprintf( line + length, sizeof(line) - length, ",\"%s\":%d", TELEMETRY_VALUE_NAMES[record.mType][i], record.mValue[i] );
+                }
+                chunk.append( line, length );
+                chunk.append( "}\n" );
+            }
+            
+            if( ++count == chunkRecords )
+            {
+                break;
+            }
+        }
+        
+        if( !chunk.empty() )
+        {
+            if( !mFailed && Write( chunk.data(), chunk.size() ) )
+            {
+                mWritten.fetch_add( count );
+            }
+            else
+            {
+                mFailed = true;
+                mLost.fetch_add( count );
+            }
+            chunk.clear();
+        }
+        
+        //Only sleep when the ring ran empty, a full chunk is followed by the next one right away
+        if( count < chunkRecords )
+        {
+            if( stop )
+            {
+                break;
+            }
+            std::this_thread::sleep_for( std::chrono::milliseconds( TELEMETRY_DRAIN_MS ) );
+        }
+    }
+    
+    if( mFile != NULL )
+    {
+        fflush( mFile );
+    }
+}
+
+bool Telemetry::Write( const void *data_, size_t size )
+{
+    if( mFile != NULL )
+    {
+        return fwrite( data_, 1, size, mFile ) == size;
+    }
+#ifndef _WIN32
+    //The reader may go away - a failed send ends the export instead of raising SIGPIPE
+    const char *data = (const char *)data_;
+    while( size > 0 )
+    {
+#ifdef MSG_NOSIGNAL
+        ssize_t sent = send( mSocket, data, size, MSG_NOSIGNAL );
+#else
+        ssize_t sent = send( mSocket, data, size, 0 );
+#endif
+        if( sent <= 0 )
+        {
+            return false;
+        }
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned long Telemetry::GetWritten() const
+{
+    return(mWritten.load());
+}
+
+unsigned long Telemetry::GetDropped() const
+{
+    return(mRing.GetDropped() + mLost.load());
+}
+
+bool ParseTelemetryFormat( const char *name, TelemetryFormat *format )
+{
+    if( strcmp( name, "binary" ) == 0 )
+    {
+        *format = TELEMETRY_BINARY;
+    }
+    else if( strcmp( name, "json" ) == 0 )
+    {
+        *format = TELEMETRY_JSON;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+//
+//  telemetry.hpp
+//  Game
+//
+//  Live telemetry: the game loop writes fixed size records into a lock-free single producer /
+//  single consumer ring, a background thread drains the ring to a file (binary or JSON lines)
+//  or a Unix domain socket. A full ring drops records, the game loop never waits.
+//
+
+#ifndef telemetry_h
+#define telemetry_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+
+//Records the ring holds (a power of two)
+const unsigned int TELEMETRY_RING_RECORDS = 8192;
+//Time the drain thread sleeps when the ring is empty
+const unsigned int TELEMETRY_DRAIN_MS = 10;
+//Prefix of a telemetry target that is a Unix domain socket ("unix:/path/to/socket")
+const char *const TELEMETRY_SOCKET_PREFIX = "unix:";
+
+//What a record is about
+enum TelemetryType
+{
+    TELEMETRY_FRAME, //a rendered frame: frame time (us), ticks run, parachutists alive
+    TELEMETRY_TICK, //a simulation tick: tick time (ns), parachutists alive
+    TELEMETRY_SCORE, //a parachutist was caught: score, parachutist X offset
+    TELEMETRY_LIFE_LOST, //a parachutist passed the boat: lives left, parachutist X offset
+    TELEMETRY_SPAWN, //a parachutist jumped: jump X offset, parachutists alive
+    TELEMETRY_GAME_OVER, //the game ended: score
+    TELEMETRY_TYPE_COUNT
+};
+
+//One telemetry record (32 bytes)
+struct TelemetryRecord
+{
+    uint64_t mTime; //microseconds since the telemetry was opened
+    uint64_t mTick; //simulation tick the record belongs to
+    uint32_t mType; //TelemetryType
+    int32_t mValue[3]; //meaning depends on the type (see TelemetryType)
+};
+
+//Start of a binary telemetry stream
+struct TelemetryHeader
+{
+    char mMagic[4]; //"PTLM"
+    uint32_t mVersion;
+    uint32_t mRecordSize; //sizeof(TelemetryRecord)
+    uint32_t mReserved;
+};
+
+//Lock-free ring for one producer thread and one consumer thread
+class TelemetryRing
+{
+public:
+    //Constructor: allocates capacity_ records (rounded up to a power of two)
+    TelemetryRing( unsigned int capacity_ = TELEMETRY_RING_RECORDS );
+    
+    //Producer: adds a record - returns false (and counts the drop) when the ring is full
+    bool Push( const TelemetryRecord &record_ );
+    //Consumer: takes the oldest record - returns false when the ring is empty
+    bool Pop( TelemetryRecord &record_ );
+    
+    //Records dropped because the ring was full
+    unsigned long GetDropped() const;
+    
+private:
+    
+    TelemetryRing( const TelemetryRing &other_); //disable copy constructor
+    
+    std::vector<TelemetryRecord> mRecords;
+    uint64_t mMask; //capacity - 1
+    
+    //Each index is written by one side only - padded apart so the two sides do not share a cache line
+    std::atomic<uint64_t> mHead; //next record to write (producer)
+    char mHeadPadding[64];
+    std::atomic<uint64_t> mTail; //next record to read (consumer)
+    char mTailPadding[64];
+    std::atomic<unsigned long> mDropped; //written by the producer
+};
+
+//Telemetry of a run: the producer side records, a thread exports
+class Telemetry
+{
+public:
+    //Constructor: opens the target (a file path or "unix:" and a socket path) and starts the drain thread.
+    //Throws when the target can not be opened.
+    Telemetry( const char *target_, TelemetryFormat format_ );
+    //Destructor: closes the telemetry
+    ~Telemetry();
+    
+    //Drains the remaining records, stops the drain thread and closes the target (later records are not exported)
+    void Close();
+    
+    //Adds a record with the current time (never blocks, from the producer thread only)
+    void Record( TelemetryType type, uint64_t tick, int32_t value0 = 0, int32_t value1 = 0, int32_t value2 = 0 );
+    
+    //Statistics
+    unsigned long GetWritten() const; //records exported
+    unsigned long GetDropped() const; //records dropped because the ring was full or the target failed
+    
+private:
+    
+    Telemetry( const Telemetry &other_); //disable copy constructor
+    
+    //Drain thread: exports the records until the telemetry is closed
+    void Drain();
+    //Writes bytes to the target - returns false when the target failed
+    bool Write( const void *data_, size_t size );
+    
+    TelemetryFormat mFormat;
+    FILE *mFile; //file target (NULL for a socket)
+    int mSocket; //socket target (-1 for a file)
+    bool mFailed; //the target failed, the records are thrown away (drain thread only)
+    std::chrono::steady_clock::time_point mStart; //time 0 of the records
+    
+    TelemetryRing mRing;
+    std::atomic<bool> mStop; //set to end the drain thread
+    std::atomic<unsigned long> mWritten;
+    std::atomic<unsigned long> mLost; //records taken from the ring after the target failed
+    std::thread mThread;
+};
+
+//Parses a telemetry format name ("binary" or "json") - returns false for an unknown name
+bool ParseTelemetryFormat( const char *name, TelemetryFormat *format );
+
+#endif /* telemetry_h */
@@ -0,0 +1,179 @@
+//
+//  text.cpp
+//  Game
+//
+
+#include <SDL2/SDL.h>
+#include <stdexcept>
+
+#include "text.hpp"
+#include "game.hpp"
+#include "render.hpp"
+
+GlyphAtlas::GlyphAtlas(Game *mGamePtr_): mGamePtr(mGamePtr_), mTexture(NULL), mWidth(0), mHeight(0)
+{
+    for( int i = 0; i < GLYPH_COUNT; ++i )
+    {
+        SDL_Rect empty = { 0, 0, 0, 0 };
+        mGlyphs[i] = empty;
+        mAdvance[i] = 0;
+    }
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    free();
+}
+
+void GlyphAtlas::free()
+{
+    SDL_DestroyTexture( mTexture );
+    mTexture = NULL;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+void GlyphAtlas::load( TTF_Font *font, SDL_Color textColor )
+{
+    std::string errormsg;
+    SDL_Surface* glyphSurfaces[GLYPH_COUNT];
+    
+    //Get rid of preexisting atlas
+    free();
+    
+    //Render every glyph and place it in the atlas rows
+    int penX = 0, penY = 0, rowHeight = 0;
+    for( int i = 0; i < GLYPH_COUNT; ++i )
+    {
+        Uint16 ch = (Uint16)(FIRST_GLYPH + i);
+        int minx, maxx, miny, maxy;
+        if( TTF_GlyphMetrics( font, ch, &minx, &maxx, &miny, &maxy, &mAdvance[i] ) == -1 )
+        {
+            mAdvance[i] = 0;
+        }
+        
+        glyphSurfaces[i] = TTF_RenderGlyph_Solid( font, ch, textColor );
+        if( glyphSurfaces[i] == NULL )
+        {
+            //Glyph missing from the font (e.g. space in some fonts) - it only moves the pen
+            SDL_Rect empty = { 0, 0, 0, 0 };
+            mGlyphs[i] = empty;
+            continue;
+        }
+        
+        //Start a new row if the glyph does not fit
+        if( penX + glyphSurfaces[i]->w > GLYPH_ATLAS_WIDTH )
+        {
+            penX = 0;
+            penY += rowHeight;
+            rowHeight = 0;
+        }
+        SDL_Rect glyphRect = { penX, penY, glyphSurfaces[i]->w, glyphSurfaces[i]->h };
+        mGlyphs[i] = glyphRect;
+        penX += glyphSurfaces[i]->w;
+        if( glyphSurfaces[i]->h > rowHeight )
+        {
+            rowHeight = glyphSurfaces[i]->h;
+        }
+    }
+    mWidth = GLYPH_ATLAS_WIDTH;
+    mHeight = penY + rowHeight;
+    
+    //Copy all glyphs into one transparent surface
+    SDL_Surface* atlasSurface = SDL_CreateRGBSurfaceWithFormat( 0, mWidth, mHeight, 32, SDL_PIXELFORMAT_RGBA32 );
+    if( atlasSurface == NULL )
+    {
+        errormsg = "Unable to create glyph atlas surface! SDL Error: %s\n";
+        errormsg.append(SDL_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    SDL_FillRect( atlasSurface, NULL, SDL_MapRGBA( atlasSurface->format, 0, 0, 0, 0 ) );
+    for( int i = 0; i < GLYPH_COUNT; ++i )
+    {
+        if( glyphSurfaces[i] != NULL )
+        {
+            SDL_BlitSurface( glyphSurfaces[i], NULL, atlasSurface, &mGlyphs[i] );
+            SDL_FreeSurface( glyphSurfaces[i] );
+        }
+    }
+    
+    //Create texture from surface pixels
+    mTexture = SDL_CreateTextureFromSurface( mGamePtr->GetRenderer(), atlasSurface );
+    SDL_FreeSurface( atlasSurface );
+    if( mTexture == NULL )
+    {
+        errormsg = "Unable to create glyph atlas texture! SDL Error: %s\n";
+        errormsg.append(SDL_GetError());
+        throw std::runtime_error(errormsg.c_str());
+    }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+}
+
+void GlyphAtlas::layout( const std::string &text, int x, int y, std::vector<SDL_Vertex> &vertices, std::vector<int> &indices ) const
+{
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    float penX = (float)x;
+    
+    for( std::string::const_iterator it = text.begin(); it != text.end(); ++it )
+    {
+        int ch = (unsigned char)*it;
+        if( ch < FIRST_GLYPH || ch > LAST_GLYPH )
+        {
+            ch = '?';
+        }
+        const SDL_Rect &glyph = mGlyphs[ch - FIRST_GLYPH];
+        
+        if( glyph.w > 0 )
+        {
+            //Screen corners and atlas corners of the glyph quad
+            float left = penX, top = (float)y, right = penX + glyph.w, bottom = (float)(y + glyph.h);
+            float u0 = (float)glyph.x / mWidth, v0 = (float)glyph.y / mHeight;
+            float u1 = (float)(glyph.x + glyph.w) / mWidth, v1 = (float)(glyph.y + glyph.h) / mHeight;
+            
+            int first = (int)vertices.size();
+            SDL_Vertex corner;
+            corner.color = white;
+            corner.position.x = left;  corner.position.y = top;    corner.tex_coord.x = u0; corner.tex_coord.y = v0; vertices.push_back( corner );
+            corner.position.x = right; corner.position.y = top;    corner.tex_coord.x = u1; corner.tex_coord.y = v0; vertices.push_back( corner );
+            corner.position.x = right; corner.position.y = bottom; corner.tex_coord.x = u1; corner.tex_coord.y = v1; vertices.push_back( corner );
+            corner.position.x = left;  corner.position.y = bottom; corner.tex_coord.x = u0; corner.tex_coord.y = v1; vertices.push_back( corner );
+            
+            //Two triangles per quad
+            indices.push_back( first );     indices.push_back( first + 1 ); indices.push_back( first + 2 );
+            indices.push_back( first );     indices.push_back( first + 2 ); indices.push_back( first + 3 );
+        }
+        penX += mAdvance[ch - FIRST_GLYPH];
+    }
+}
+
+SDL_Texture* GlyphAtlas::getTexture() const
+{
+    return(mTexture);
+}
+
+TextLabel::TextLabel(const GlyphAtlas &atlas_): mAtlas(atlas_), mPosX(0), mPosY(0), mLaidOut(false)
+{}
+
+bool TextLabel::setText( const std::string &text, int x, int y )
+{
+    //Nothing to do if the text did not change
+    if( text == mText && x == mPosX && y == mPosY && mLaidOut )
+    {
+        return false;
+    }
+    mText = text;
+    mPosX = x;
+    mPosY = y;
+    
+    //Rebuild the quads (the vectors keep their capacity so this rarely allocates)
+    mVertices.clear();
+    mIndices.clear();
+    mAtlas.layout( mText, mPosX, mPosY, mVertices, mIndices );
+    mLaidOut = true;
+    return true;
+}
+
+void TextLabel::render( RenderQueue &queue, int layer ) const
+{
+    queue.PushGeometry( layer, mAtlas.getTexture(), mVertices, mIndices );
+}
@@ -0,0 +1,92 @@
+//
+//  text.hpp
+//  Game
+//
+//  Glyph atlas text rendering: the font is rasterised once into a single
+//  texture and strings are drawn as batched quads from it.
+//
+
+#ifndef text_h
+#define text_h
+
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <vector>
+
+class Game;
+class RenderQueue;
+
+//Range of characters rasterised into the atlas (printable ASCII)
+const int FIRST_GLYPH = 32;
+const int LAST_GLYPH = 126;
+const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+
+//Maximum width of a row of glyphs in the atlas texture
+const int GLYPH_ATLAS_WIDTH = 512;
+
+//All glyphs of a font in one texture
+class GlyphAtlas
+{
+public:
+    //Initializes variables
+    GlyphAtlas(Game *mGamePtr_);
+    
+    //Deallocates memory
+    ~GlyphAtlas();
+    
+    //Rasterises every glyph of the font into the atlas texture (done once)
+    void load( TTF_Font *font, SDL_Color textColor );
+    
+    //Appends the quads of a string drawn at given point
+    void layout( const std::string &text, int x, int y, std::vector<SDL_Vertex> &vertices, std::vector<int> &indices ) const;
+    
+    //Returns the atlas texture
+    SDL_Texture* getTexture() const;
+    
+    //Releases the atlas texture
+    void free();
+    
+private:
+    
+    GlyphAtlas( const GlyphAtlas &other_); //disable copy constructor
+    
+    // pointer to game
+    Game *mGamePtr;
+    //The atlas hardware texture
+    SDL_Texture* mTexture;
+    
+    //Atlas dimensions
+    int mWidth;
+    int mHeight;
+    
+    //Location of each glyph in the atlas and how far it moves the pen
+    SDL_Rect mGlyphs[GLYPH_COUNT];
+    int mAdvance[GLYPH_COUNT];
+};
+
+//A string drawn from the glyph atlas, its quads are rebuilt only when the text changes
+class TextLabel
+{
+public:
+    //Initializes variables
+    TextLabel(const GlyphAtlas &atlas_);
+    
+    //Sets the text and its position - returns true if the quads had to be rebuilt
+    bool setText( const std::string &text, int x, int y );
+    
+    //Queues the text on a layer of the render queue (a single batched draw)
+    void render( RenderQueue &queue, int layer ) const;
+    
+private:
+    
+    TextLabel( const TextLabel &other_); //disable copy constructor
+    
+    const GlyphAtlas &mAtlas; //atlas the text is drawn from
+    std::string mText; //current text
+    int mPosX, mPosY; //position of the text
+    bool mLaidOut; //set once the quads were built
+    std::vector<SDL_Vertex> mVertices; //quads of the text (kept between frames)
+    std::vector<int> mIndices;
+};
+
+#endif /* text_h */
@@ -0,0 +1,167 @@
+//
+//  threadpool.cpp
+//  Game
+//
+
+#include "threadpool.hpp"
+
+//Index of the worker running on this thread (-1 outside the pool)
+static thread_local int gWorkerIndex = -1;
+//Pool the worker belongs to
+static thread_local const void *gWorkerPool = NULL;
+
+ThreadPool::ThreadPool(unsigned int threads_): mQueued(0), mPending(0), mSteals(0), mNextQueue(0), mStop(false)
+{
+    unsigned int threads = threads_ > 0 ? threads_ : std::thread::hardware_concurrency();
+    if( threads == 0 )
+    {
+        threads = 1;
+    }
+    
+    for( unsigned int i = 0; i < threads; ++i )
+    {
+        mQueues.push_back( new WorkQueue );
+    }
+    for( unsigned int i = 0; i < threads; ++i )
+    {
+        mThreads.push_back( std::thread( &ThreadPool::Work, this, i ) );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mStop = true;
+    }
+    mWakeUp.notify_all();
+    for( size_t i = 0; i < mThreads.size(); ++i )
+    {
+        mThreads[i].join();
+    }
+    for( size_t i = 0; i < mQueues.size(); ++i )
+    {
+        delete mQueues[i];
+    }
+}
+
+void ThreadPool::Submit( const std::function<void()> &task_ )
+{
+    //Tasks made by a task stay with its worker (it runs them newest first while they are hot in its cache)
+    unsigned int index;
+    if( gWorkerPool == this )
+    {
+        index = (unsigned int)gWorkerIndex;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        index = mNextQueue;
+        mNextQueue = ( mNextQueue + 1 ) % mQueues.size();
+    }
+    
+    //Count the task before a worker can see it - a worker may run (or steal) it as soon as it is queued
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        ++mQueued;
+        ++mPending;
+    }
+    {
+        std::lock_guard<std::mutex> lock( mQueues[index]->mMutex );
+        mQueues[index]->mTasks.push_back( task_ );
+    }
+    mWakeUp.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock( mMutex );
+    while( mPending > 0 )
+    {
+        mDone.wait( lock );
+    }
+}
+
+bool ThreadPool::PopLocal( unsigned int index, std::function<void()> &task_ )
+{
+    std::lock_guard<std::mutex> lock( mQueues[index]->mMutex );
+    if( mQueues[index]->mTasks.empty() )
+    {
+        return false;
+    }
+    task_.swap( mQueues[index]->mTasks.back() );
+    mQueues[index]->mTasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::Steal( unsigned int index, std::function<void()> &task_ )
+{
+    //Look at the other queues starting with the next worker so thieves spread out
+    for( size_t offset = 1; offset < mQueues.size(); ++offset )
+    {
+        WorkQueue &victim = *mQueues[( index + offset ) % mQueues.size()];
+        std::lock_guard<std::mutex> lock( victim.mMutex );
+        if( !victim.mTasks.empty() )
+        {
+            task_.swap( victim.mTasks.front() );
+            victim.mTasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Work( unsigned int index )
+{
+    gWorkerIndex = (int)index;
+    gWorkerPool = this;
+    
+    for( ;; )
+    {
+        std::function<void()> task;
+        bool local = PopLocal( index, task );
+        if( local || Steal( index, task ) )
+        {
+            {
+                std::lock_guard<std::mutex> lock( mMutex );
+                --mQueued;
+                if( !local )
+                {
+                    ++mSteals;
+                }
+            }
+            
+            task();
+            
+            std::lock_guard<std::mutex> lock( mMutex );
+            if( --mPending == 0 )
+            {
+                mDone.notify_all();
+            }
+            continue;
+        }
+        
+        //Nothing to run - sleep until a task is queued
+        std::unique_lock<std::mutex> lock( mMutex );
+        while( mQueued == 0 && !mStop )
+        {
+            mWakeUp.wait( lock );
+        }
+        if( mStop && mQueued == 0 )
+        {
+            return;
+        }
+    }
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+    return (unsigned int)mThreads.size();
+}
+
+unsigned long ThreadPool::GetSteals() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return(mSteals);
+}
@@ -0,0 +1,68 @@
+//
+//  threadpool.hpp
+//  Game
+//
+//  Work stealing thread pool: every worker runs tasks from its own queue (newest first) and
+//  steals the oldest task of another worker when its queue is empty, so uneven tasks
+//  (e.g. games of different lengths) keep every core busy.
+//
+
+#ifndef threadpool_h
+#define threadpool_h
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool
+{
+public:
+    //Constructor: starts the workers (0 = one per core)
+    ThreadPool(unsigned int threads_ = 0);
+    //Destructor: runs the queued tasks and stops the workers
+    ~ThreadPool();
+    
+    //Queues a task - from a worker it goes to the worker's own queue, otherwise the queues take turns
+    void Submit( const std::function<void()> &task_ );
+    //Waits until every submitted task ran
+    void Wait();
+    
+    //Statistics
+    unsigned int GetThreadCount() const;
+    unsigned long GetSteals() const; //tasks a worker took from another worker's queue
+    
+private:
+    
+    ThreadPool( const ThreadPool &other_); //disable copy constructor
+    
+    //Queue of one worker
+    struct WorkQueue
+    {
+        std::mutex mMutex;
+        std::deque< std::function<void()> > mTasks;
+    };
+    
+    //Worker thread
+    void Work( unsigned int index );
+    //Takes the newest task of a worker's own queue
+    bool PopLocal( unsigned int index, std::function<void()> &task_ );
+    //Takes the oldest task of another worker's queue
+    bool Steal( unsigned int index, std::function<void()> &task_ );
+    
+    std::vector<WorkQueue*> mQueues; //one per worker
+    std::vector<std::thread> mThreads;
+    
+    mutable std::mutex mMutex; //guards the members below
+    std::condition_variable mWakeUp; //signalled when a task is queued or the pool stops
+    std::condition_variable mDone; //signalled when the last pending task finished
+    unsigned long mQueued; //tasks in the queues
+    unsigned long mPending; //tasks not finished
+    unsigned long mSteals;
+    unsigned int mNextQueue; //queue of the next task submitted from outside the pool
+    bool mStop;
+};
+
+#endif /* threadpool_h */
@@ -0,0 +1,55 @@
+//
+//  threadpool_test.cpp
+//  Game
+//
+//  Test of the thread pool: tasks submitted by tasks are counted as soon as they are submitted,
+//  so Wait() returns only after the tasks and every task they made finished.
+//
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "threadpool.hpp"
+
+//Rounds of the test and tasks per round
+const int TEST_ROUNDS = 500;
+const int TEST_PARENTS = 4;
+const int TEST_CHILDREN = 16;
+
+int main()
+{
+    ThreadPool pool( 4 );
+    std::atomic<int> finished( 0 );
+    int failures = 0;
+    
+    for( int round = 0; round < TEST_ROUNDS; ++round )
+    {
+        finished.store( 0 );
+        for( int i = 0; i < TEST_PARENTS; ++i )
+        {
+            pool.Submit( [&pool, &finished]()
+            {
+                for( int j = 0; j < TEST_CHILDREN; ++j )
+                {
+                    pool.Submit( [&finished]() { ++finished; } );
+                }
+                //Keep the parent running while the other workers steal its children
+                std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+                ++finished;
+            } );
+        }
+        pool.Wait();
+        
+        int expected = TEST_PARENTS * ( TEST_CHILDREN + 1 );
+        if( finished.load() != expected )
+        {
+            printf( "Round %d: Wait() returned after %d of %d tasks\n", round, finished.load(), expected );
+            ++failures;
+        }
+    }
+    
+    printf( "Thread pool: %d of %d rounds failed, %lu steals\n", failures, TEST_ROUNDS, pool.GetSteals() );
+    return failures == 0 ? 0 : 1;
+}
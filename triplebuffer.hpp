@@ -0,0 +1,61 @@
+//
+//  triplebuffer.hpp
+//  Game
+//
+//  Triple buffer for one writer thread and one reader thread: the writer fills the back copy and
+//  publishes it, the reader takes the newest published copy. Publishing and taking swap an index
+//  in one atomic exchange - neither side ever waits for the other, and a copy is never written
+//  while it is read.
+//
+
+#ifndef triplebuffer_h
+#define triplebuffer_h
+
+#include <atomic>
+
+template <class T>
+class TripleBuffer
+{
+public:
+    //Constructor: the reader starts with copy 0, the writer with copy 2
+    TripleBuffer(): mMiddle(1), mBack(2), mFront(0) {}
+    
+    //Writer: the copy to fill
+    T &GetBack() { return(mCopies[mBack]); }
+    //Writer: makes the back copy the newest one, the writer gets another copy to fill
+    void Publish()
+    {
+        mBack = mMiddle.exchange( mBack | FRESH, std::memory_order_acq_rel ) & INDEX;
+    }
+    
+    //Reader: takes the newest published copy - returns false (and keeps the front copy) when nothing new was published
+    bool Update()
+    {
+        if( ( mMiddle.load( std::memory_order_relaxed ) & FRESH ) == 0 )
+        {
+            return false;
+        }
+        mFront = mMiddle.exchange( mFront, std::memory_order_acq_rel ) & INDEX;
+        return true;
+    }
+    //Reader: the copy to read
+    const T &GetFront() const { return(mCopies[mFront]); }
+    
+private:
+    
+    TripleBuffer( const TripleBuffer &other_); //disable copy constructor
+    
+    static const unsigned int INDEX = 3; //bits of the copy index
+    static const unsigned int FRESH = 4; //set when the middle copy was published and not taken yet
+    
+    T mCopies[3];
+    
+    //The copy between the two sides (and the fresh bit) - each side keeps its own index on its own cache line
+    std::atomic<unsigned int> mMiddle;
+    char mMiddlePadding[64];
+    unsigned int mBack; //writer only
+    char mBackPadding[64];
+    unsigned int mFront; //reader only
+};
+
+#endif /* triplebuffer_h */